@@ -0,0 +1,453 @@
+#ifndef _ABSEARCH_H
+#define _ABSEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <stdint.h>
+#include "threats.h"
+#include "ttable.h"
+#include "workpool.h"
+#include "../m/mlist.h"
+using namespace std;
+
+
+// how long abSearch may think about one move.  It stops at whichever of
+// milliseconds and depth runs out first, or as soon as the value is
+// proved; 0 turns a limit off (at least one must be set).
+struct searchLimits
+{
+    int milliseconds;                        // wall-clock time per move
+    int depth;                               // deepest iteration, in moves
+    int threads;                             // 0 means one per core
+    int ttBits;                              // shared table of 2^ttBits
+
+    searchLimits( ) : milliseconds(1000), depth(0), threads(1), ttBits(20) { }
+};
+
+// parallel alpha-beta player (lazy SMP) for boards too big for solver
+// to finish in time.  Every thread runs the same iterative-deepening
+// negamax from the root, sharing one lock-free transposition table
+// (sharedTable); every other helper searches one move deeper, so they
+// fill the table with results the main thread then finds instead of
+// searching.  The move played is the main thread's from its deepest
+// finished iteration.  Positions are kept as threatState: leaves are
+// scored by its open lines (a line only one player has marks on is
+// worth 4^marks to that player) and moves are tried in its threat order.
+template <int N, int K>
+class abSearch
+{
+  public:
+
+    typedef nkBoard<N, K> board;
+    typedef typename board::mask mask;
+    typedef typename board::ops ops;
+    typedef typename board::rules rules;
+
+    static constexpr int CELLS = N * N;
+    static constexpr int WIN = 30000;        // win with no marks on the board
+    static constexpr int INF = WIN + 1;
+    static constexpr int EVAL_MAX = WIN / 2; // heuristic scores stay below
+
+  // constructor/destructor
+    explicit abSearch( const searchLimits & limits );
+    ~abSearch( );
+
+  // searching
+    int bestMove( const board & pos );       // move for pos.toMove()
+    int bestMove( const board & pos, int & score );
+
+  // accessors
+    long long nodes( ) const;                // in the last search, all threads
+    int depth( ) const;                      // deepest finished iteration
+    bool proved( ) const;                    // last score is exact
+    int threads( ) const;
+    static int winScore( int marks );        // score of a win at marks
+
+  // modifiers
+    void clear( );                           // forget the table
+
+  private:
+
+    struct worker
+    {
+        threatState<N, K> game;
+        long long nodes;
+        char pad[64];                        // keeps workers off each other's lines
+    };
+
+    typedef chrono::steady_clock clock;
+
+    void think( worker & w, int id, int maxDepth );
+    int negamax( worker & w, int depth, int alpha, int beta, int * bestOut );
+    int evaluate( const threatState<N, K> & game ) const;
+
+    abSearch( const abSearch & );            // not copyable
+    void operator = ( const abSearch & );
+
+    searchLimits myLimits;
+    sharedTable myTable;
+    workPool * myPool;                       // 0 when single threaded
+    mlist<worker> myWorkers;
+
+    atomic<bool> myStop;                     // deadline passed or main thread done
+    clock::time_point myDeadline;
+    bool myTimed;                            // myDeadline applies
+
+    int myBestMove;                          // from the main thread
+    int myBestScore;
+    int myDepth;
+    bool myProved;
+};
+
+
+// *******************************************************************
+// Specifications for abSearch functions
+//
+//  explicit abSearch( const searchLimits & limits );
+//     precondition: limits.milliseconds > 0 or limits.depth > 0;
+//                   0 <= limits.ttBits < 31
+//     postcondition: a player with limits.threads search threads sharing
+//                    a table of 2^ttBits entries
+//
+//  int bestMove( const board & pos );
+//  int bestMove( const board & pos, int & score );
+//     precondition: resultOf(pos) == ONGOING
+//     postcondition: returns an open cell for pos.toMove() (and sets
+//                    score to its value: winScore(n) for a forced win
+//                    ending with n marks, its negative for a loss, a
+//                    heuristic score in (-EVAL_MAX, EVAL_MAX) otherwise).
+//                    With a time limit the move comes back within it: the
+//                    threads check the clock every 1024 nodes, and a move
+//                    is ready from the start (a win, a block, or the first
+//                    candidate) in case not even depth 1 finishes.
+//
+//  bool proved( ) const;
+//     postcondition: true if the last search proved a win or loss, or
+//                    searched every move to the end of the game
+//
+//  Search notes: as in solver, a node wins at once if it has a winning
+//  cell, loses if the opponent has two, and must block if the opponent
+//  has one.  Table entries are used for cutoffs when they were searched
+//  at least as deep.  The table's move is tried first, then
+//  threatState::candidates (so boards bigger than 7 x 7 only try cells
+//  within two of a mark).
+//
+//  Examples of use:
+//
+//     searchLimits limits;
+//     limits.milliseconds = 500;
+//     limits.threads = 0;                   // every core
+//     abSearch<5,4> brain(limits);
+//     int cell = brain.bestMove(pos);
+
+template <int N, int K>
+abSearch<N, K>::abSearch(const searchLimits & limits)
+    : myLimits(limits),
+      myTable(limits.ttBits),
+      myPool(0),
+      myStop(false),
+      myTimed(false),
+      myBestMove(-1),
+      myBestScore(0),
+      myDepth(0),
+      myProved(false)
+{
+    if(limits.milliseconds <= 0 && limits.depth <= 0)
+    {
+        cerr << "abSearch needs a time or depth limit" << endl;
+        exit(1);
+    }
+    if(limits.threads != 1)
+    {
+        myPool = new workPool(limits.threads);
+    }
+    myWorkers.resize(myPool ? myPool->size() : 1);
+}
+
+template <int N, int K>
+abSearch<N, K>::~abSearch()
+{
+    delete myPool;
+}
+
+template <int N, int K>
+int abSearch<N, K>::bestMove(const board & pos)
+// precondition: resultOf(pos) == ONGOING
+{
+    int score;
+    return bestMove(pos, score);
+}
+
+template <int N, int K>
+int abSearch<N, K>::bestMove(const board & pos, int & score)
+// precondition: resultOf(pos) == ONGOING
+// postcondition: returns an open cell for pos.toMove(), score is its value
+{
+    char p = pos.toMove();
+    char q = (p == 'x') ? 'o' : 'x';
+    int marks = pos.numMoves();
+    threatState<N, K> root(pos);
+
+    // a move is ready before any searching starts
+    mask wins = root.winningCells(p);
+    if(ops::any(wins))
+    {
+        score = winScore(marks + 1);
+        myDepth = 1;
+        myProved = true;
+        return ops::first(wins);
+    }
+    mask threats = root.winningCells(q);
+    uint8_t first[CELLS];
+    root.order(ops::any(threats) ? threats : root.candidateCells(), first);
+    myBestMove = first[0];
+    myBestScore = 0;
+    myDepth = 0;
+    myProved = false;
+
+    myStop = false;
+    myTimed = myLimits.milliseconds > 0;
+    myDeadline = clock::now() + chrono::milliseconds(myLimits.milliseconds);
+    int maxDepth = CELLS - marks;
+    if(myLimits.depth > 0 && myLimits.depth < maxDepth)
+    {
+        maxDepth = myLimits.depth;
+    }
+
+    for(int id = 0; id < myWorkers.size(); id++)
+    {
+        myWorkers[id].game = root;
+        myWorkers[id].nodes = 0;
+    }
+    if(myPool)
+    {
+        for(int id = 0; id < myWorkers.size(); id++)
+        {
+            myPool->submit([this, id, maxDepth](int) { think(myWorkers[id], id, maxDepth); });
+        }
+        myPool->wait();
+    }
+    else
+    {
+        think(myWorkers[0], 0, maxDepth);
+    }
+
+    score = myBestScore;
+    return myBestMove;
+}
+
+template <int N, int K>
+long long abSearch<N, K>::nodes() const
+{
+    long long total = 0;
+    for(int id = 0; id < myWorkers.size(); id++)
+    {
+        total += myWorkers[id].nodes;
+    }
+    return total;
+}
+
+template <int N, int K>
+int abSearch<N, K>::depth() const
+{
+    return myDepth;
+}
+
+template <int N, int K>
+bool abSearch<N, K>::proved() const
+{
+    return myProved;
+}
+
+template <int N, int K>
+int abSearch<N, K>::threads() const
+{
+    return myWorkers.size();
+}
+
+template <int N, int K>
+int abSearch<N, K>::winScore(int marks)
+{
+    return WIN - marks;
+}
+
+template <int N, int K>
+void abSearch<N, K>::clear()
+{
+    myTable.clear();
+}
+
+template <int N, int K>
+void abSearch<N, K>::think(worker & w, int id, int maxDepth)
+// postcondition: w has searched deeper and deeper until stopped; the main
+//                thread (id 0) has recorded its deepest finished result
+{
+    for(int d = 1; d <= maxDepth && !myStop; d++)
+    {
+        int depth = d;
+        if(id > 0 && (id & 1) && d < maxDepth)
+        {
+            depth++;                         // odd helpers run one ahead
+        }
+        int move = -1;
+        int score = negamax(w, depth, -INF, INF, &move);
+        if(myStop)
+        {
+            break;                           // unfinished: not trusted
+        }
+        if(id == 0)
+        {
+            myBestMove = move;
+            myBestScore = score;
+            myDepth = depth;
+            myProved = (depth == maxDepth && maxDepth == CELLS - w.game.game().numMoves()) ||
+                       score >= WIN - CELLS || score <= -(WIN - CELLS);
+            if(myProved)
+            {
+                break;
+            }
+        }
+    }
+    if(id == 0)
+    {
+        myStop = true;                       // the helpers are done too
+    }
+}
+
+template <int N, int K>
+int abSearch<N, K>::negamax(worker & w, int depth, int alpha, int beta, int * bestOut)
+// precondition: the game is ongoing
+// postcondition: returns the depth-limited value for the side to move if
+//                it lies in (alpha,beta), otherwise a bound on the far
+//                side; meaningless once myStop is set
+{
+    if((++w.nodes & 1023) == 0 && myTimed && clock::now() >= myDeadline)
+    {
+        myStop = true;
+    }
+    if(myStop.load(memory_order_relaxed))
+    {
+        return 0;
+    }
+
+    threatState<N, K> & game = w.game;
+    char p = game.game().toMove();
+    char q = (p == 'x') ? 'o' : 'x';
+    int marks = game.game().numMoves();
+
+    // win now, lose to two threats, or block one
+    mask wins = game.winningCells(p);
+    if(ops::any(wins))
+    {
+        if(bestOut)
+        {
+            *bestOut = ops::first(wins);
+        }
+        return winScore(marks + 1);
+    }
+    mask moves = game.candidateCells();
+    mask threats = game.winningCells(q);
+    int numThreats = ops::count(threats);
+    if(numThreats >= 2)
+    {
+        if(bestOut)
+        {
+            *bestOut = ops::first(threats);
+        }
+        return -winScore(marks + 2);
+    }
+    if(numThreats == 1)
+    {
+        moves = threats;
+    }
+    if(depth <= 0)
+    {
+        return evaluate(game);
+    }
+
+    // shared table: cut off on deep enough entries, else try its move first
+    int alphaOrig = alpha;
+    int ttMove = -1;
+    uint64_t key = game.game().hash();
+    ttEntry e;
+    int stored;
+    if(myTable.probe(key, e, stored))
+    {
+        if(ops::test(moves, e.move))
+        {
+            ttMove = e.move;
+        }
+        if(!bestOut && stored >= depth)
+        {
+            if(e.bound == TT_EXACT ||
+               (e.bound == TT_LOWER && e.score >= beta) ||
+               (e.bound == TT_UPPER && e.score <= alpha))
+            {
+                return e.score;
+            }
+        }
+    }
+
+    uint8_t order[CELLS];
+    int count = game.order(moves, order);
+    int best = -INF;
+    int bestCell = -1;
+    for(int k = -1; k < count; k++)
+    {
+        int c = (k < 0) ? ttMove : order[k];
+        if(c < 0 || (k >= 0 && c == ttMove))
+        {
+            continue;
+        }
+
+        game.apply(c);
+        int score = game.game().result() == DRAW ? 0 : -negamax(w, depth - 1, -beta, -alpha, 0);
+        game.undo();
+        if(myStop.load(memory_order_relaxed))
+        {
+            return 0;
+        }
+
+        if(score > best)
+        {
+            best = score;
+            bestCell = c;
+            if(score > alpha)
+            {
+                alpha = score;
+                if(alpha >= beta)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    ttBound bound = best <= alphaOrig ? TT_UPPER : best >= beta ? TT_LOWER : TT_EXACT;
+    myTable.store(key, best, bound, bestCell, depth);
+    if(bestOut)
+    {
+        *bestOut = bestCell;
+    }
+    return best;
+}
+
+template <int N, int K>
+int abSearch<N, K>::evaluate(const threatState<N, K> & game) const
+// postcondition: returns the open-line score for the side to move,
+//                kept inside (-EVAL_MAX, EVAL_MAX)
+{
+    int score = game.evaluate();
+    if(score >= EVAL_MAX)
+    {
+        return EVAL_MAX - 1;
+    }
+    if(score <= -EVAL_MAX)
+    {
+        return -EVAL_MAX + 1;
+    }
+    return score;
+}
+
+#endif
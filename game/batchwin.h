@@ -0,0 +1,273 @@
+#ifndef _BATCHWIN_H
+#define _BATCHWIN_H
+
+#include <stdint.h>
+#include "winlines.h"
+#include "../m/mlist.h"
+
+#if defined(__AVX512BW__) || defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+
+// results for many boards at once.  The boards are kept as a structure
+// of arrays (all x masks, then all o masks) so that one vector register
+// holds the same mask of 8 (SSE2), 16 (AVX2) or 32 (AVX-512BW) boards,
+// and each winning line is tested against all of them with one AND and
+// one compare.  The instruction set is picked when compiling: build with
+// -mavx2 (or -march=native) for the wider versions; without any of them
+// a scalar loop is used.  Only boards whose masks fit in 16 bits
+// (3 x 3 and 4 x 4) can be batched.
+template <int N, int K>
+class boardBatch
+{
+  public:
+
+    typedef nkBoard<N, K> board;
+    typedef nkRules<N, K> rules;
+    typedef typename board::mask mask;
+
+    static_assert(sizeof(mask) == sizeof(uint16_t), "batches need 16-bit masks");
+
+  // constructor
+    boardBatch( );
+
+  // filling
+    void add( const board & pos );           // append one board
+    void add( mask xMarks, mask oMarks );
+    void clear( );                           // forget every board
+
+  // accessors
+    int size( ) const;                       // number of boards
+    const mask * xMarks( ) const;            // size() x masks, in order
+    const mask * oMarks( ) const;            // size() o masks, in order
+
+  // results
+    void results( gameResult * out ) const;  // out[k] = result of board k
+    static int width( );                     // boards per vector step
+
+  private:
+
+    mlist<mask> myX;                         // x marks of each board
+    mlist<mask> myO;                         // o marks of each board
+};
+
+template <int N, int K>
+void batchResults( const uint16_t * xMarks, const uint16_t * oMarks,
+                   int count, gameResult * out );
+
+
+// *******************************************************************
+// Specifications for batch win functions
+//
+//  void add( const board & pos );
+//  void add( mask xMarks, mask oMarks );
+//     postcondition: the board is appended; mlist growth is amortized,
+//                    so filling a batch of n boards costs O(n)
+//
+//  void results( gameResult * out ) const;
+//     precondition: out has room for size() results
+//     postcondition: out[k] == resultOf(board k) for every board (a
+//                    board with lines for both players reports X_WINS)
+//
+//  static int width( );
+//     postcondition: returns 32, 16 or 8 for the AVX-512BW, AVX2 or SSE2
+//                    build, 1 for the scalar one
+//
+//  void batchResults( const uint16_t * xMarks, const uint16_t * oMarks,
+//                     int count, gameResult * out );
+//     precondition: each array has count entries
+//     postcondition: out[k] is the result of the board with marks
+//                    xMarks[k] and oMarks[k]; whole vectors are done with
+//                    SIMD and the remainder with the scalar loop
+//
+//  Examples of use:
+//
+//     boardBatch<3,3> batch;
+//     for(int k = 0; k < n; k++)
+//         batch.add(positions[k]);
+//     vector<gameResult> result(batch.size());
+//     batch.results(&result[0]);
+
+static_assert(sizeof(gameResult) == sizeof(int32_t), "results are stored as 32-bit lanes");
+
+template <int N, int K>
+boardBatch<N, K>::boardBatch()
+{
+
+}
+
+template <int N, int K>
+void boardBatch<N, K>::add(const board & pos)
+{
+    add(pos.marks('x'), pos.marks('o'));
+}
+
+template <int N, int K>
+void boardBatch<N, K>::add(mask xMarks, mask oMarks)
+// postcondition: the board is appended
+{
+    int k = myX.size();
+    myX.resize(k + 1);
+    myO.resize(k + 1);
+    myX[k] = xMarks;
+    myO[k] = oMarks;
+}
+
+template <int N, int K>
+void boardBatch<N, K>::clear()
+// postcondition: size() == 0, the storage is kept for reuse
+{
+    myX.resize(0);
+    myO.resize(0);
+}
+
+template <int N, int K>
+int boardBatch<N, K>::size() const
+{
+    return myX.size();
+}
+
+template <int N, int K>
+const typename boardBatch<N, K>::mask * boardBatch<N, K>::xMarks() const
+{
+    return myX.size() > 0 ? &myX[0] : 0;
+}
+
+template <int N, int K>
+const typename boardBatch<N, K>::mask * boardBatch<N, K>::oMarks() const
+{
+    return myO.size() > 0 ? &myO[0] : 0;
+}
+
+template <int N, int K>
+void boardBatch<N, K>::results(gameResult * out) const
+// precondition: out has room for size() results
+{
+    batchResults<N, K>(xMarks(), oMarks(), size(), out);
+}
+
+template <int N, int K>
+int boardBatch<N, K>::width()
+{
+#if defined(__AVX512BW__)
+    return 32;
+#elif defined(__AVX2__)
+    return 16;
+#elif defined(__SSE2__)
+    return 8;
+#else
+    return 1;
+#endif
+}
+
+template <int N, int K>
+void batchResults(const uint16_t * xMarks, const uint16_t * oMarks,
+                  int count, gameResult * out)
+// precondition: each array has count entries
+// postcondition: out[k] is the result of board k
+{
+    typedef nkRules<N, K> rules;
+    const uint16_t FULL = (uint16_t) rules::TABLE.full;
+    int k = 0;
+#if defined(__SSE2__)
+    int32_t * lanes = (int32_t *) out;       // the vector code's view of out
+#endif
+
+    // each step: winX/winO are all ones in the lanes of boards that have
+    // a line; the result is built as DRAW for full boards, then overwritten
+    // by O_WINS and X_WINS (X last, as resultOf checks it first)
+
+#if defined(__AVX512BW__)
+    for(; k + 32 <= count; k += 32)
+    {
+        __m512i x = _mm512_loadu_si512((const void *) (xMarks + k));
+        __m512i o = _mm512_loadu_si512((const void *) (oMarks + k));
+        __mmask32 winX = 0, winO = 0;
+        for(int j = 0; j < rules::LINES; j++)
+        {
+            __m512i line = _mm512_set1_epi16((short) rules::TABLE.line[j]);
+            winX |= _mm512_cmpeq_epi16_mask(_mm512_and_si512(x, line), line);
+            winO |= _mm512_cmpeq_epi16_mask(_mm512_and_si512(o, line), line);
+        }
+        __mmask32 full = _mm512_cmpeq_epi16_mask(_mm512_or_si512(x, o),
+                                                 _mm512_set1_epi16((short) FULL));
+        for(int half = 0; half < 2; half++)  // 16 32-bit results at a time
+        {
+            int shift = 16 * half;
+            __m512i r = _mm512_maskz_mov_epi32((__mmask16) (full >> shift), _mm512_set1_epi32(DRAW));
+            r = _mm512_mask_mov_epi32(r, (__mmask16) (winO >> shift), _mm512_set1_epi32(O_WINS));
+            r = _mm512_mask_mov_epi32(r, (__mmask16) (winX >> shift), _mm512_set1_epi32(X_WINS));
+            _mm512_storeu_si512((void *) (lanes + k + shift), r);
+        }
+    }
+#endif
+
+#if defined(__AVX2__)
+    for(; k + 16 <= count; k += 16)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (xMarks + k));
+        __m256i o = _mm256_loadu_si256((const __m256i *) (oMarks + k));
+        __m256i winX = _mm256_setzero_si256();
+        __m256i winO = _mm256_setzero_si256();
+        for(int j = 0; j < rules::LINES; j++)
+        {
+            __m256i line = _mm256_set1_epi16((short) rules::TABLE.line[j]);
+            winX = _mm256_or_si256(winX, _mm256_cmpeq_epi16(_mm256_and_si256(x, line), line));
+            winO = _mm256_or_si256(winO, _mm256_cmpeq_epi16(_mm256_and_si256(o, line), line));
+        }
+        __m256i full = _mm256_cmpeq_epi16(_mm256_or_si256(x, o), _mm256_set1_epi16((short) FULL));
+        __m256i r = _mm256_and_si256(full, _mm256_set1_epi16(DRAW));
+        r = _mm256_blendv_epi8(r, _mm256_set1_epi16(O_WINS), winO);
+        r = _mm256_blendv_epi8(r, _mm256_set1_epi16(X_WINS), winX);
+        _mm256_storeu_si256((__m256i *) (lanes + k),
+                            _mm256_cvtepu16_epi32(_mm256_castsi256_si128(r)));
+        _mm256_storeu_si256((__m256i *) (lanes + k + 8),
+                            _mm256_cvtepu16_epi32(_mm256_extracti128_si256(r, 1)));
+    }
+#endif
+
+#if defined(__SSE2__)
+    for(; k + 8 <= count; k += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *) (xMarks + k));
+        __m128i o = _mm_loadu_si128((const __m128i *) (oMarks + k));
+        __m128i winX = _mm_setzero_si128();
+        __m128i winO = _mm_setzero_si128();
+        for(int j = 0; j < rules::LINES; j++)
+        {
+            __m128i line = _mm_set1_epi16((short) rules::TABLE.line[j]);
+            winX = _mm_or_si128(winX, _mm_cmpeq_epi16(_mm_and_si128(x, line), line));
+            winO = _mm_or_si128(winO, _mm_cmpeq_epi16(_mm_and_si128(o, line), line));
+        }
+        __m128i full = _mm_cmpeq_epi16(_mm_or_si128(x, o), _mm_set1_epi16((short) FULL));
+        __m128i r = _mm_and_si128(full, _mm_set1_epi16(DRAW));
+        r = _mm_or_si128(_mm_andnot_si128(winO, r), _mm_and_si128(winO, _mm_set1_epi16(O_WINS)));
+        r = _mm_or_si128(_mm_andnot_si128(winX, r), _mm_and_si128(winX, _mm_set1_epi16(X_WINS)));
+        __m128i zero = _mm_setzero_si128();
+        _mm_storeu_si128((__m128i *) (lanes + k), _mm_unpacklo_epi16(r, zero));
+        _mm_storeu_si128((__m128i *) (lanes + k + 4), _mm_unpackhi_epi16(r, zero));
+    }
+#endif
+
+    // scalar fallback and the boards left over after the last full vector
+    for(; k < count; k++)
+    {
+        if(rules::hasWin(xMarks[k]))
+        {
+            out[k] = X_WINS;
+        }
+        else if(rules::hasWin(oMarks[k]))
+        {
+            out[k] = O_WINS;
+        }
+        else
+        {
+            out[k] = (uint16_t) (xMarks[k] | oMarks[k]) == FULL ? DRAW : ONGOING;
+        }
+    }
+}
+
+#endif
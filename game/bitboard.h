@@ -0,0 +1,309 @@
+#ifndef _BITBOARD_H
+#define _BITBOARD_H
+
+#include <iostream>
+#include <cstdlib>
+#include "../m/matrix.h"
+#include "rules.h"
+using namespace std;
+
+
+// compact N x N game state: one bit mask per player, bit k is cell k,
+// where cell = row * N + col
+template <int N, int K>
+class nkBoard
+{
+  public:
+
+    typedef nkRules<N, K> rules;
+    typedef typename rules::mask mask;       // narrowest mask for N*N cells
+    typedef maskOps<mask> ops;
+
+    static constexpr int SIZE = N;           // rows == cols
+    static constexpr int RUN = K;            // marks in a row to win
+    static constexpr int CELLS = N * N;      // number of cells
+
+  // constructors
+    nkBoard( );                              // empty board
+    nkBoard( const mask & xs, const mask & os ); // board from player masks
+
+  // conversion to/from the interactive board
+    static nkBoard fromMatrix( const matrix<char> & board );
+    void toMatrix( matrix<char> & board, char empty ) const;
+
+  // accessors
+    const mask & marks( char p ) const;      // cells marked by player p
+    mask occupied( ) const;                  // cells marked by anyone
+    mask legalMoves( ) const;                // cells still open
+    bool isOpen( int cell ) const;           // true if cell has no mark
+    bool validMove( int row, int col ) const;  // on the board and open
+    char at( int cell, char empty ) const;   // 'x', 'o' or empty
+    int  numMoves( ) const;                  // marks on the board
+    bool isFull( ) const;                    // no open cells left
+    char toMove( ) const;                    // 'x' moves first
+
+  // modifiers
+    void apply( int cell, char p );          // mark cell for player p
+    void undo( int cell );                   // clear cell
+
+  // cell helpers
+    static int cellOf( int row, int col );
+    static int rowOf( int cell );
+    static int colOf( int cell );
+    static int firstCell( const mask & m );  // lowest set cell of m
+    static mask bit( int cell );
+    static mask full( );                     // every cell
+
+  private:
+
+    mask myX;                                // cells marked 'x'
+    mask myO;                                // cells marked 'o'
+};
+
+typedef nkBoard<3, 3>  bitboard;             // the classic game
+typedef nkBoard<4, 4>  board4;               // 4 x 4, 4 in a row
+typedef nkBoard<5, 4>  board5k4;             // 5 x 5, 4 in a row
+typedef nkBoard<15, 5> gomokuBoard;          // 15 x 15, 5 in a row
+
+
+// *******************************************************************
+// Specifications for nkBoard functions
+//
+// Cells are numbered 0..N*N-1 in row-major order.  Every function is a
+// handful of bit operations; nothing allocates and only validMove is
+// range checked, so other callers must check bounds first.
+//
+//  static nkBoard fromMatrix( const matrix<char> & board );
+//     precondition: board is N x N
+//     postcondition: returns the packed form of board; any entry other
+//                    than 'x' or 'o' is treated as open
+//
+//  void toMatrix( matrix<char> & board, char empty ) const;
+//     postcondition: board is N x N and holds 'x', 'o' or empty per cell
+//
+//  const mask & marks( char p ) const;
+//     precondition: p is 'x' or 'o'
+//     postcondition: returns the cells marked by p
+//
+//  mask legalMoves( ) const;
+//     postcondition: returns a mask with one bit per open cell
+//
+//  bool validMove( int row, int col ) const;
+//     postcondition: returns true if (row,col) is on the board and open
+//
+//  char toMove( ) const;
+//     postcondition: returns 'x' if both players have made the same
+//                    number of moves, otherwise 'o'
+//
+//  void apply( int cell, char p );
+//     precondition: 0 <= cell < N*N, isOpen(cell), p is 'x' or 'o'
+//     postcondition: cell is marked for p
+//
+//  void undo( int cell );
+//     precondition: 0 <= cell < N*N
+//     postcondition: cell is open
+//
+//  static int firstCell( const mask & m );
+//     precondition: m has a set bit
+//     postcondition: returns the index of the lowest set bit
+//
+//  Examples of use:
+//
+//     bitboard pos;
+//     pos.apply(bitboard::cellOf(1,1), 'x');
+//     for(bitboard::mask m = pos.legalMoves(); bitboard::ops::any(m);
+//         bitboard::ops::clearFirst(m))
+//         cout << bitboard::firstCell(m);
+
+template <int N, int K>
+nkBoard<N, K>::nkBoard()
+// postcondition: empty board
+    : myX(),
+      myO()
+{
+
+}
+
+template <int N, int K>
+nkBoard<N, K>::nkBoard(const mask & xs, const mask & os)
+// postcondition: board with xs marked 'x' and os marked 'o'
+    : myX(xs),
+      myO(os)
+{
+
+}
+
+template <int N, int K>
+nkBoard<N, K> nkBoard<N, K>::fromMatrix(const matrix<char> & board)
+// precondition: board is N x N
+// postcondition: returns the packed form of board
+{
+    nkBoard pos;
+    int row, col;
+    for(row = 0; row < SIZE; row++)
+    {
+        for(col = 0; col < SIZE; col++)
+        {
+            char c = board[row][col];
+            if(c == 'x' || c == 'o')
+            {
+                pos.apply(cellOf(row, col), c);
+            }
+        }
+    }
+    return pos;
+}
+
+template <int N, int K>
+void nkBoard<N, K>::toMatrix(matrix<char> & board, char empty) const
+// postcondition: board is N x N and holds 'x', 'o' or empty per cell
+{
+    if(board.numRows() != SIZE || board.numCols() != SIZE)
+    {
+        board.resize(SIZE, SIZE);
+    }
+    int cell;
+    for(cell = 0; cell < CELLS; cell++)
+    {
+        board[rowOf(cell)][colOf(cell)] = at(cell, empty);
+    }
+}
+
+template <int N, int K>
+const typename nkBoard<N, K>::mask & nkBoard<N, K>::marks(char p) const
+// precondition: p is 'x' or 'o'
+// postcondition: returns the cells marked by p
+{
+    return p == 'x' ? myX : myO;
+}
+
+template <int N, int K>
+typename nkBoard<N, K>::mask nkBoard<N, K>::occupied() const
+// postcondition: returns the cells marked by anyone
+{
+    return (mask) (myX | myO);
+}
+
+template <int N, int K>
+typename nkBoard<N, K>::mask nkBoard<N, K>::legalMoves() const
+// postcondition: returns a mask with one bit per open cell
+{
+    return (mask) (full() & ops::invert(occupied()));
+}
+
+template <int N, int K>
+bool nkBoard<N, K>::isOpen(int cell) const
+// postcondition: returns true if cell has no mark
+{
+    return !ops::test(occupied(), cell);
+}
+
+template <int N, int K>
+bool nkBoard<N, K>::validMove(int row, int col) const
+// postcondition: returns true if (row,col) is on the board and open
+{
+    if(row < 0 || row >= N || col < 0 || col >= N)
+    {
+        return false;
+    }
+    return isOpen(cellOf(row, col));
+}
+
+template <int N, int K>
+char nkBoard<N, K>::at(int cell, char empty) const
+// postcondition: returns 'x', 'o' or empty
+{
+    if(ops::test(myX, cell))
+    {
+        return 'x';
+    }
+    if(ops::test(myO, cell))
+    {
+        return 'o';
+    }
+    return empty;
+}
+
+template <int N, int K>
+int nkBoard<N, K>::numMoves() const
+// postcondition: returns the number of marks on the board
+{
+    return ops::count(occupied());
+}
+
+template <int N, int K>
+bool nkBoard<N, K>::isFull() const
+// postcondition: returns true if no open cells are left
+{
+    return occupied() == full();
+}
+
+template <int N, int K>
+char nkBoard<N, K>::toMove() const
+// postcondition: returns the player whose turn it is
+{
+    return ops::count(myX) == ops::count(myO) ? 'x' : 'o';
+}
+
+template <int N, int K>
+void nkBoard<N, K>::apply(int cell, char p)
+// precondition: isOpen(cell), p is 'x' or 'o'
+// postcondition: cell is marked for p
+{
+    if(p == 'x')
+    {
+        myX |= bit(cell);
+    }
+    else
+    {
+        myO |= bit(cell);
+    }
+}
+
+template <int N, int K>
+void nkBoard<N, K>::undo(int cell)
+// postcondition: cell is open
+{
+    myX &= ops::invert(bit(cell));
+    myO &= ops::invert(bit(cell));
+}
+
+template <int N, int K>
+int nkBoard<N, K>::cellOf(int row, int col)
+{
+    return row * SIZE + col;
+}
+
+template <int N, int K>
+int nkBoard<N, K>::rowOf(int cell)
+{
+    return cell / SIZE;
+}
+
+template <int N, int K>
+int nkBoard<N, K>::colOf(int cell)
+{
+    return cell % SIZE;
+}
+
+template <int N, int K>
+int nkBoard<N, K>::firstCell(const mask & m)
+// precondition: m has a set bit
+// postcondition: returns the index of the lowest set bit
+{
+    return ops::first(m);
+}
+
+template <int N, int K>
+typename nkBoard<N, K>::mask nkBoard<N, K>::bit(int cell)
+{
+    return ops::bit(cell);
+}
+
+template <int N, int K>
+typename nkBoard<N, K>::mask nkBoard<N, K>::full()
+{
+    return rules::TABLE.full;
+}
+
+#endif
@@ -0,0 +1,624 @@
+#ifndef _BOOK_H
+#define _BOOK_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "symmetry.h"
+#include "../m/mlist.h"
+#include "../m/stathooks.h"
+using namespace std;
+
+
+// opening book: the computer's move for positions it has already
+// searched, built offline by tools/buildbook and loaded at startup.
+// Entries are keyed by the Zobrist hash of the canonical board (the
+// canonicalize representative), so one entry answers for every rotation
+// and reflection of its position, and moves are stored in the canonical
+// orientation.  The entries are kept sorted by key and
+// found by binary search.
+//
+// file layout (native byte order, the structs as they are in memory; a
+// file from a machine of the other order has a byte-swapped version and
+// open() turns it down):
+//   bookHeader               24 bytes
+//   bookEntry[entries]       16 bytes each, increasing key
+
+const char BOOK_MAGIC[8] = { 'T', 'T', 'T', 'B', 'O', 'O', 'K', 'S' };
+const uint32_t BOOK_VERSION = 2;          // 1 keyed by symHash::canonical
+
+struct bookHeader
+{
+    char     magic[8];                       // BOOK_MAGIC
+    uint32_t version;                        // BOOK_VERSION
+    uint16_t size;                           // rows == cols
+    uint16_t run;                            // marks in a row to win
+    uint32_t entries;                        // bookEntry records that follow
+    uint32_t reserved;                       // 0
+};
+
+struct bookEntry
+{
+    uint64_t key;                            // hash of the canonical board
+    int16_t  score;                          // for the side to move
+    uint8_t  move;                           // canonical orientation
+    uint8_t  exact;                          // 1 if score was proved
+    uint32_t reserved;                       // 0
+};
+
+static_assert(sizeof(bookHeader) == 24 && sizeof(bookEntry) == 16,
+              "the structs are the file layout");
+
+class openingBook
+{
+  public:
+
+  // constructor
+    openingBook( );                          // empty, for no board
+
+  // files
+    bool open( const char * path );          // load a whole book file
+    bool save( const char * path );          // write it, sorted
+    bool isOpen( ) const;                    // has entries
+
+  // lookups
+    template <int N, int K>
+    bool find( const nkBoard<N, K> & pos, int & move ) const;
+    const bookEntry * entry( uint64_t key ) const;
+
+  // accessors
+    int size( ) const;                       // entries
+    int boardSize( ) const;
+    int run( ) const;
+    long long hits( ) const;
+
+  // modifiers
+    void setBoard( int size, int run );      // empties the book
+    template <int N, int K>
+    void add( const nkBoard<N, K> & pos, int move, int score, bool exact );
+
+  private:
+
+    void sort( );
+    static int byKey( const void * a, const void * b );
+
+    mlist<bookEntry> myEntries;              // capacity, not count
+    int myCount;
+    int mySize;
+    int myRun;
+    bool mySorted;
+    mutable long long myHits;
+};
+
+// bounded LRU cache of computed moves, keyed like the book.  Its nodes
+// are allocated once, so the memory stays at capacity entries however
+// long it runs; when it is full, storing a new result evicts the one
+// used least recently.  A hash table of chains finds a key, and a
+// doubly linked list through the nodes keeps them in order of use.
+class resultCache
+{
+  public:
+
+  // constructor
+    explicit resultCache( int capacity );    // at most capacity results
+
+  // lookups
+    template <int N, int K>
+    bool find( const nkBoard<N, K> & pos, int & move );
+    template <int N, int K>
+    void store( const nkBoard<N, K> & pos, int move );
+    bool find( uint64_t key, int & move );
+    void store( uint64_t key, int move );
+
+  // accessors
+    int size( ) const;
+    int capacity( ) const;
+    long long hits( ) const;
+    long long misses( ) const;
+    long long evictions( ) const;
+
+  // modifiers
+    void clear( );
+    void setCapacity( int capacity );        // empties the cache
+
+  private:
+
+    struct node
+    {
+        uint64_t key;
+        int move;
+        int prev, next;                      // use order, -1 at the ends
+        int chain;                           // next node in the bucket
+    };
+
+    int lookup( uint64_t key ) const;        // node of key, or -1
+    void unlink( int n );
+    void pushFront( int n );
+    void unchain( int n );
+
+    resultCache( const resultCache & );      // not copyable
+    void operator = ( const resultCache & );
+
+    mlist<node> myNodes;
+    mlist<int> myBuckets;                    // first node of each chain
+    int myMask;                              // buckets - 1
+    int mySize;
+    int myHead;                              // most recently used
+    int myTail;                              // least recently used
+    long long myHits;
+    long long myMisses;
+    long long myEvictions;
+};
+
+template <int N, int K>
+uint64_t canonicalKey( const nkBoard<N, K> & pos, canonicalForm<N, K> & form );
+
+
+// *******************************************************************
+// Specifications for book functions
+//
+//  bool openingBook::open( const char * path );
+//     postcondition: if path is a whole book file (sorted keys, every
+//                    move on the board), the book holds its entries and
+//                    board and true is returned; otherwise the book is
+//                    unchanged and false is returned
+//
+//  bool openingBook::save( const char * path );
+//     precondition: setBoard has been called
+//     postcondition: the entries, sorted by key, are written to path;
+//                    returns false if it can't be written
+//
+//  bool openingBook::find( const nkBoard<N,K> & pos, int & move ) const;
+//     postcondition: if the book is for N x N, K in a row and holds pos
+//                    (in any orientation), move is its book move in
+//                    pos's orientation and true is returned.  O(log n).
+//                    A stored move that is not open on pos (a 64-bit key
+//                    collision) is not returned.
+//
+//  void openingBook::add( const nkBoard<N,K> & pos, int move, int score,
+//                         bool exact );
+//     precondition: the book is for N x N, K in a row; -32768 <= score <
+//                   32768; pos is not in the book yet
+//     postcondition: pos's canonical form maps to move
+//
+//  explicit resultCache( int capacity );
+//  void setCapacity( int capacity );
+//     precondition: capacity >= 0 (0 keeps nothing)
+//     postcondition: an empty cache with room for capacity results; the
+//                    node and bucket arrays are allocated here and never
+//                    grow
+//
+//  bool resultCache::find( const nkBoard<N,K> & pos, int & move );
+//     postcondition: on a hit, move is the stored move in pos's
+//                    orientation, the entry becomes the most recently
+//                    used and hits() goes up; otherwise misses() does.
+//                    A stored move that is not open on pos (a key
+//                    collision) is not returned.
+//
+//  void resultCache::store( const nkBoard<N,K> & pos, int move );
+//     postcondition: pos (in any orientation) maps to move and is the
+//                    most recently used entry; if the cache was full the
+//                    least recently used entry is gone
+//
+//  uint64_t canonicalKey( const nkBoard<N,K> & pos,
+//                         canonicalForm<N,K> & form );
+//     postcondition: form is canonicalize(pos) and the Zobrist hash of
+//                    form.board is returned; symmetric positions get the
+//                    same key
+//
+//  Examples of use:
+//
+//     openingBook book;
+//     resultCache cache(4096);
+//     book.open("gomoku.book");
+//     int move;
+//     if(!book.find(pos, move) && !cache.find(pos, move))
+//     {
+//         move = brain.bestMove(pos);
+//         cache.store(pos, move);
+//     }
+
+template <int N, int K>
+uint64_t canonicalKey(const nkBoard<N, K> & pos, canonicalForm<N, K> & form)
+// postcondition: form is pos's canonical form, returns its hash
+{
+    typedef typename nkBoard<N, K>::mask mask;
+    typedef typename nkBoard<N, K>::ops ops;
+
+    form = canonicalize(pos);
+    uint64_t key = 0;
+    for(mask m = form.board.marks('x'); ops::any(m); ops::clearFirst(m))
+    {
+        key ^= zobrist<N * N>::KEYS.cell('x', ops::first(m));
+    }
+    for(mask m = form.board.marks('o'); ops::any(m); ops::clearFirst(m))
+    {
+        key ^= zobrist<N * N>::KEYS.cell('o', ops::first(m));
+    }
+    return key;
+}
+
+inline openingBook::openingBook()
+    : myCount(0),
+      mySize(0),
+      myRun(0),
+      mySorted(true),
+      myHits(0)
+{
+
+}
+
+inline bool openingBook::open(const char * path)
+// postcondition: the book holds the file's entries if it is a book
+{
+    FILE * f = fopen(path, "rb");
+    if(!f)
+    {
+        return false;
+    }
+    bookHeader h;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 &&
+              memcmp(h.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) == 0 &&
+              h.version == BOOK_VERSION && h.size <= 16 &&
+              fseek(f, 0, SEEK_END) == 0 &&
+              ftell(f) == (long) (sizeof(h) + (size_t) h.entries * sizeof(bookEntry)) &&
+              fseek(f, sizeof(h), SEEK_SET) == 0;
+    mlist<bookEntry> entries;
+    if(ok && h.entries > 0)
+    {
+        entries.resize((int) h.entries);
+        ok = fread(&entries[0], sizeof(bookEntry), h.entries, f) == h.entries;
+    }
+    fclose(f);
+    for(uint32_t k = 0; ok && k < h.entries; k++)
+    {
+        ok = entries[k].move < h.size * h.size &&
+             (k == 0 || entries[k - 1].key < entries[k].key);
+    }
+    if(!ok)
+    {
+        return false;
+    }
+    myEntries.swap(entries);
+    myCount = (int) h.entries;
+    mySize = h.size;
+    myRun = h.run;
+    mySorted = true;
+    return true;
+}
+
+inline bool openingBook::save(const char * path)
+// precondition: setBoard has been called
+{
+    sort();
+    bookHeader h;
+    memcpy(h.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    h.version = BOOK_VERSION;
+    h.size = (uint16_t) mySize;
+    h.run = (uint16_t) myRun;
+    h.entries = (uint32_t) myCount;
+    h.reserved = 0;
+
+    FILE * f = fopen(path, "wb");
+    if(!f)
+    {
+        return false;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+              (myCount == 0 ||
+               fwrite(&myEntries[0], sizeof(bookEntry), myCount, f) == (size_t) myCount);
+    return (fclose(f) == 0) && ok;
+}
+
+inline bool openingBook::isOpen() const
+{
+    return myCount > 0;
+}
+
+template <int N, int K>
+bool openingBook::find(const nkBoard<N, K> & pos, int & move) const
+// postcondition: move is the book move for pos, if it has one
+{
+    if(N != mySize || K != myRun)
+    {
+        return false;
+    }
+    canonicalForm<N, K> form;
+    const bookEntry * e = entry(canonicalKey(pos, form));
+    if(!e || !pos.isOpen(form.toOriginal(e->move)))
+    {
+        return false;                        // not there, or a key collision
+    }
+    move = form.toOriginal(e->move);
+    myHits++;
+    STAT_COUNT(STAT_BOOK_HITS);
+    return true;
+}
+
+inline const bookEntry * openingBook::entry(uint64_t key) const
+// precondition: the entries are sorted (true after open or save)
+// postcondition: returns the entry for key, or 0
+{
+    int lo = 0, hi = myCount;
+    while(lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if(myEntries[mid].key < key)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return (lo < myCount && myEntries[lo].key == key) ? &myEntries[lo] : 0;
+}
+
+inline int openingBook::size() const
+{
+    return myCount;
+}
+
+inline int openingBook::boardSize() const
+{
+    return mySize;
+}
+
+inline int openingBook::run() const
+{
+    return myRun;
+}
+
+inline long long openingBook::hits() const
+{
+    return myHits;
+}
+
+inline void openingBook::setBoard(int size, int run)
+// postcondition: an empty book for size x size, run in a row
+{
+    myCount = 0;
+    mySize = size;
+    myRun = run;
+    mySorted = true;
+}
+
+template <int N, int K>
+void openingBook::add(const nkBoard<N, K> & pos, int move, int score, bool exact)
+// precondition: the book is for N x N, K in a row
+{
+    canonicalForm<N, K> form;
+    bookEntry e;
+    e.key = canonicalKey(pos, form);
+    e.score = (int16_t) score;
+    e.move = (uint8_t) form.toCanonical(move);
+    e.exact = exact ? 1 : 0;
+    e.reserved = 0;
+    if(myCount == myEntries.size())
+    {
+        myEntries.resize(myCount > 0 ? 2 * myCount : 64);
+    }
+    myEntries[myCount++] = e;
+    mySorted = false;
+}
+
+inline void openingBook::sort()
+// postcondition: the entries are in increasing key order
+{
+    if(!mySorted && myCount > 0)
+    {
+        qsort(&myEntries[0], myCount, sizeof(bookEntry), byKey);
+    }
+    mySorted = true;
+}
+
+inline int openingBook::byKey(const void * a, const void * b)
+// postcondition: qsort order of two entries, by key
+{
+    uint64_t x = ((const bookEntry *) a)->key;
+    uint64_t y = ((const bookEntry *) b)->key;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+inline resultCache::resultCache(int capacity)
+    : myMask(0),
+      myHits(0),
+      myMisses(0),
+      myEvictions(0)
+{
+    setCapacity(capacity);
+}
+
+template <int N, int K>
+bool resultCache::find(const nkBoard<N, K> & pos, int & move)
+// postcondition: move is the stored move for pos, if there is one
+{
+    canonicalForm<N, K> form;
+    if(!find(canonicalKey(pos, form), move) ||
+       !pos.isOpen(form.toOriginal(move)))
+    {
+        return false;                        // not there, or a key collision
+    }
+    move = form.toOriginal(move);
+    return true;
+}
+
+template <int N, int K>
+void resultCache::store(const nkBoard<N, K> & pos, int move)
+// postcondition: pos maps to move
+{
+    canonicalForm<N, K> form;
+    uint64_t key = canonicalKey(pos, form);
+    store(key, form.toCanonical(move));
+}
+
+inline bool resultCache::find(uint64_t key, int & move)
+// postcondition: move is the stored move for key, if there is one
+{
+    int n = lookup(key);
+    if(n < 0)
+    {
+        myMisses++;
+        STAT_COUNT(STAT_CACHE_MISSES);
+        return false;
+    }
+    myHits++;
+    STAT_COUNT(STAT_CACHE_HITS);
+    move = myNodes[n].move;
+    unlink(n);
+    pushFront(n);
+    return true;
+}
+
+inline void resultCache::store(uint64_t key, int move)
+// postcondition: key maps to move and is the most recently used
+{
+    if(myNodes.size() == 0)
+    {
+        return;
+    }
+    int n = lookup(key);
+    if(n >= 0)
+    {
+        unlink(n);
+    }
+    else
+    {
+        if(mySize < myNodes.size())
+        {
+            n = mySize++;
+        }
+        else
+        {
+            n = myTail;                      // evict the least recent
+            unlink(n);
+            unchain(n);
+            myEvictions++;
+        }
+        int & bucket = myBuckets[(int) (key & (uint64_t) myMask)];
+        myNodes[n].key = key;
+        myNodes[n].chain = bucket;
+        bucket = n;
+    }
+    myNodes[n].move = move;
+    pushFront(n);
+}
+
+inline int resultCache::size() const
+{
+    return mySize;
+}
+
+inline int resultCache::capacity() const
+{
+    return myNodes.size();
+}
+
+inline long long resultCache::hits() const
+{
+    return myHits;
+}
+
+inline long long resultCache::misses() const
+{
+    return myMisses;
+}
+
+inline long long resultCache::evictions() const
+{
+    return myEvictions;
+}
+
+inline void resultCache::clear()
+// postcondition: nothing is cached; the counts are kept
+{
+    for(int b = 0; b < myBuckets.size(); b++)
+    {
+        myBuckets[b] = -1;
+    }
+    mySize = 0;
+    myHead = myTail = -1;
+}
+
+inline void resultCache::setCapacity(int capacity)
+// precondition: capacity >= 0
+// postcondition: an empty cache for capacity results
+{
+    int buckets = 1;
+    while(buckets < capacity)
+    {
+        buckets *= 2;
+    }
+    myNodes.resize(capacity);
+    myBuckets.resize(buckets);
+    myMask = buckets - 1;
+    clear();
+}
+
+inline int resultCache::lookup(uint64_t key) const
+// postcondition: returns the node holding key, or -1
+{
+    if(myNodes.size() == 0)
+    {
+        return -1;
+    }
+    int n = myBuckets[(int) (key & (uint64_t) myMask)];
+    while(n >= 0 && myNodes[n].key != key)
+    {
+        n = myNodes[n].chain;
+    }
+    return n;
+}
+
+inline void resultCache::unlink(int n)
+// postcondition: n is out of the use order
+{
+    node & x = myNodes[n];
+    if(x.prev >= 0)
+    {
+        myNodes[x.prev].next = x.next;
+    }
+    else
+    {
+        myHead = x.next;
+    }
+    if(x.next >= 0)
+    {
+        myNodes[x.next].prev = x.prev;
+    }
+    else
+    {
+        myTail = x.prev;
+    }
+}
+
+inline void resultCache::pushFront(int n)
+// postcondition: n is the most recently used
+{
+    myNodes[n].prev = -1;
+    myNodes[n].next = myHead;
+    if(myHead >= 0)
+    {
+        myNodes[myHead].prev = n;
+    }
+    myHead = n;
+    if(myTail < 0)
+    {
+        myTail = n;
+    }
+}
+
+inline void resultCache::unchain(int n)
+// postcondition: n is out of its bucket's chain
+{
+    int * link = &myBuckets[(int) (myNodes[n].key & (uint64_t) myMask)];
+    while(*link != n)
+    {
+        link = &myNodes[*link].chain;
+    }
+    *link = myNodes[n].chain;
+}
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef _GAMESTATE_H
+#define _GAMESTATE_H
+
+#include <stdint.h>
+#include "bitboard.h"
+#include "winlines.h"
+#include "zobrist.h"
+#include "../m/stathooks.h"
+using namespace std;
+
+
+// a game in progress on a packed N x N board: the board, the side to
+// move, every move made so far, the Zobrist hash and the result.  apply
+// and undo touch only the lines through the cell, each keeping a count of
+// its 'x' and 'o' marks, so a win shows up as a count reaching K and a
+// take-back never copies or rescans the board.
+template <int N, int K>
+class gameState
+{
+  public:
+
+    typedef nkBoard<N, K> board;
+    typedef nkRules<N, K> rules;
+
+    static constexpr int CELLS = N * N;
+    static constexpr int LINES = rules::LINES;
+
+    static_assert(N * N <= 256, "moves are stored as one byte per cell");
+
+  // constructors
+    gameState( );                            // empty board, 'x' to move
+    explicit gameState( const board & pos ); // pick up a game at pos
+
+  // accessors
+    const board & position( ) const;         // the packed board
+    char toMove( ) const;                    // 'x' or 'o'
+    int  numMoves( ) const;                  // moves on the stack
+    int  move( int k ) const;                // cell of move k, 0 = first
+    int  lastMove( ) const;                  // cell of the latest move
+    const uint8_t * moves( ) const;          // the move stack, oldest first
+    uint64_t hash( ) const;                  // Zobrist hash of the marks
+    gameResult result( ) const;              // as of the latest move
+    bool isOpen( int cell ) const;
+    int  lineCount( char p, int line ) const;  // p's marks on line
+
+  // modifiers
+    void apply( int cell );                  // toMove() marks cell
+    void undo( );                            // take back the latest move
+    void clear( );                           // back to the empty board
+
+  private:
+
+    board myBoard;
+    char mySide;                             // who moves next
+    int myNumMoves;
+    uint8_t myMoves[CELLS];                  // the move stack
+    uint64_t myHash;
+    gameResult myResult;
+    uint8_t myCount[2][LINES];               // [0] = 'x', [1] = 'o'
+};
+
+
+// *******************************************************************
+// Specifications for gameState functions
+//
+// Everything is constant time: apply and undo visit the lines through
+// one cell (at most 4K), the rest are single lookups.  Nothing
+// allocates, so states can be copied or kept in pools freely.
+//
+//  explicit gameState( const board & pos );
+//     precondition: pos was reached by legal play ('x' first) and
+//                   resultOf(pos) == ONGOING
+//     postcondition: the state of pos with pos.toMove() to move; the
+//                    history is unknown, so the move stack holds pos's
+//                    marks in cell order, 'x' and 'o' alternating
+//
+//  int move( int k ) const;
+//     precondition: 0 <= k < numMoves()
+//     postcondition: returns the cell of the k-th move; 'x' made the
+//                    even ones
+//
+//  int lastMove( ) const;
+//     precondition: numMoves() > 0
+//
+//  const uint8_t * moves( ) const;
+//     postcondition: numMoves() cells in the order played, the layout a
+//                    game record stores (game/record.h)
+//
+//  uint64_t hash( ) const;
+//     postcondition: the XOR of zobrist<N*N>::KEYS.cell over the marks,
+//                    the same hash the solver keys its table with
+//
+//  int lineCount( char p, int line ) const;
+//     precondition: p is 'x' or 'o', 0 <= line < LINES
+//     postcondition: returns how many of the cells of
+//                    rules::TABLE.line[line] p has marked
+//
+//  void apply( int cell );
+//     precondition: result() == ONGOING, 0 <= cell < N*N, isOpen(cell)
+//     postcondition: toMove() has marked cell, the move is on the stack,
+//                    the other player is to move and result() is the
+//                    win for the mover if a line through cell now holds
+//                    K of their marks, DRAW if the board is full, or
+//                    ONGOING
+//
+//  void undo( );
+//     precondition: numMoves() > 0
+//     postcondition: the state is exactly as before the latest apply
+//
+//  Examples of use:
+//
+//     gameState<3,3> game;
+//     game.apply(4);                         // x takes the center
+//     game.apply(0);                         // o a corner
+//     game.undo();                           // o thinks again
+//     if(game.result() != ONGOING) ...
+
+template <int N, int K>
+gameState<N, K>::gameState()
+// postcondition: empty board, 'x' to move
+{
+    clear();
+}
+
+template <int N, int K>
+gameState<N, K>::gameState(const board & pos)
+// precondition: pos is a legal ongoing position
+// postcondition: the state of pos with pos.toMove() to move
+{
+    clear();
+    typedef typename board::mask mask;
+    typedef typename board::ops ops;
+    mask xs = pos.marks('x');
+    mask os = pos.marks('o');
+    // no line is complete in pos, so none is on the way either
+    while(ops::any(xs) || ops::any(os))
+    {
+        mask & next = (mySide == 'x') ? xs : os;
+        apply(ops::first(next));
+        ops::clearFirst(next);
+    }
+}
+
+template <int N, int K>
+const typename gameState<N, K>::board & gameState<N, K>::position() const
+{
+    return myBoard;
+}
+
+template <int N, int K>
+char gameState<N, K>::toMove() const
+{
+    return mySide;
+}
+
+template <int N, int K>
+int gameState<N, K>::numMoves() const
+{
+    return myNumMoves;
+}
+
+template <int N, int K>
+int gameState<N, K>::move(int k) const
+// precondition: 0 <= k < numMoves()
+{
+    return myMoves[k];
+}
+
+template <int N, int K>
+int gameState<N, K>::lastMove() const
+// precondition: numMoves() > 0
+{
+    return myMoves[myNumMoves - 1];
+}
+
+template <int N, int K>
+const uint8_t * gameState<N, K>::moves() const
+{
+    return myMoves;
+}
+
+template <int N, int K>
+uint64_t gameState<N, K>::hash() const
+{
+    return myHash;
+}
+
+template <int N, int K>
+gameResult gameState<N, K>::result() const
+{
+    return myResult;
+}
+
+template <int N, int K>
+bool gameState<N, K>::isOpen(int cell) const
+{
+    return myBoard.isOpen(cell);
+}
+
+template <int N, int K>
+int gameState<N, K>::lineCount(char p, int line) const
+// precondition: p is 'x' or 'o', 0 <= line < LINES
+{
+    return myCount[p == 'x' ? 0 : 1][line];
+}
+
+template <int N, int K>
+void gameState<N, K>::apply(int cell)
+// precondition: result() == ONGOING, isOpen(cell)
+// postcondition: toMove() has marked cell and the other player is to move
+{
+    STAT_COUNT(STAT_WIN_CHECKS);             // counted, not timed: a search node
+    char p = mySide;
+    uint8_t * count = myCount[p == 'x' ? 0 : 1];
+    const short * lines = rules::TABLE.through[cell];
+    int numLines = rules::TABLE.numThrough[cell];
+    bool won = false;
+    for(int k = 0; k < numLines; k++)
+    {
+        won |= ++count[lines[k]] == K;       // keep counting: undo expects it
+    }
+
+    myBoard.apply(cell, p);
+    myMoves[myNumMoves++] = (uint8_t) cell;
+    myHash ^= zobrist<CELLS>::KEYS.cell(p, cell);
+    mySide = (p == 'x') ? 'o' : 'x';
+
+    if(won)
+    {
+        myResult = winFor(p);
+    }
+    else if(myNumMoves == CELLS)
+    {
+        myResult = DRAW;
+    }
+}
+
+template <int N, int K>
+void gameState<N, K>::undo()
+// precondition: numMoves() > 0
+// postcondition: the state is as before the latest apply
+{
+    int cell = myMoves[--myNumMoves];
+    char p = (mySide == 'x') ? 'o' : 'x';  // who made that move
+    uint8_t * count = myCount[p == 'x' ? 0 : 1];
+    const short * lines = rules::TABLE.through[cell];
+    int numLines = rules::TABLE.numThrough[cell];
+    for(int k = 0; k < numLines; k++)
+    {
+        count[lines[k]]--;
+    }
+
+    myBoard.undo(cell);
+    myHash ^= zobrist<CELLS>::KEYS.cell(p, cell);
+    mySide = p;
+    myResult = ONGOING;                      // moves are only made on ongoing games
+}
+
+template <int N, int K>
+void gameState<N, K>::clear()
+// postcondition: empty board, 'x' to move
+{
+    myBoard = board();
+    mySide = 'x';
+    myNumMoves = 0;
+    myHash = 0;
+    myResult = ONGOING;
+    for(int p = 0; p < 2; p++)
+    {
+        for(int k = 0; k < LINES; k++)
+        {
+            myCount[p][k] = 0;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef _INPUT_H
+#define _INPUT_H
+
+#include <iostream>
+#include <string>
+#include <cerrno>
+#include <unistd.h>
+#include "../m/mlist.h"
+using namespace std;
+
+
+// what moveReader::next found
+enum readStatus
+{
+    READ_OK,                                 // a number
+    READ_BAD,                                // a token that is not one
+    READ_END                                 // no input left
+};
+
+// reads the numbers a game is played with straight from a file
+// descriptor (normally stdin), a block at a time, instead of one
+// cin >> per number.  A pipe or a file is taken in 64 KB reads and
+// parsed in place; a terminal still hands over a line per read, so
+// typing works as before.  Tokens are separated by white space or
+// commas.  A move string given up front (script) is read before the
+// descriptor, which is how a whole game fits on the command line.
+class moveReader
+{
+  public:
+
+    static const int BLOCK = 1 << 16;        // bytes per read
+    static const int MAX_TOKEN = 32;         // longer bad tokens are cut
+
+  // constructor
+    explicit moveReader( int fd = 0 );       // reads descriptor fd
+
+  // reading
+    readStatus next( int & value );          // the next number
+    const string & badToken( ) const;        // after READ_BAD
+    bool scripted( ) const;                  // the script isn't used up
+
+  // modifiers
+    void script( const string & moves );     // read moves first
+    void tie( ostream * out );               // flushed before each read
+
+  private:
+
+    int get( );                              // next char, or -1 at the end
+    int peek( );
+    bool fill( );                            // read the next block
+    static bool isSeparator( int c );
+
+    moveReader( const moveReader & );        // not copyable
+    void operator = ( const moveReader & );
+
+    int myFd;
+    mlist<char> myBuffer;
+    int myStart;                             // next unread byte
+    int myEnd;                               // bytes in the buffer
+    bool myEof;                              // the descriptor is used up
+    string myScript;
+    size_t myScriptAt;                       // next unread script char
+    ostream * myTie;
+    string myBad;
+};
+
+
+// *******************************************************************
+// Specifications for moveReader functions
+//
+//  readStatus next( int & value );
+//     postcondition: the next token has been consumed.  READ_OK with
+//                    value set if it was an optionally signed decimal
+//                    number of up to 9 digits; READ_BAD if it was
+//                    anything else (badToken() holds it); READ_END if
+//                    the script and the descriptor are both used up.  A
+//                    read interrupted by a signal is retried; a read
+//                    error counts as the end.
+//
+//  bool scripted( ) const;
+//     postcondition: true if the next token comes from the script
+//
+//  void script( const string & moves );
+//     postcondition: moves ("4,0,8" or "4 0 8") is read before
+//                    anything from the descriptor
+//
+//  void tie( ostream * out );
+//     postcondition: out (if not 0) is flushed before every read of the
+//                    descriptor, so a prompt is on screen while it waits
+//
+//  Examples of use:
+//
+//     moveReader input;
+//     input.tie(&cout);
+//     int row;
+//     while(input.next(row) == READ_BAD)
+//         cout << "Not a number: " << input.badToken() << endl;
+
+inline moveReader::moveReader(int fd)
+    : myFd(fd),
+      myBuffer(BLOCK),
+      myStart(0),
+      myEnd(0),
+      myEof(false),
+      myScriptAt(0),
+      myTie(0)
+{
+
+}
+
+inline readStatus moveReader::next(int & value)
+// postcondition: the next token is consumed and classified
+{
+    int c = get();
+    while(c != -1 && isSeparator(c))
+    {
+        c = get();
+    }
+    if(c == -1)
+    {
+        return READ_END;
+    }
+
+    myBad.clear();
+    bool negative = false;
+    bool number = true;
+    int digits = 0;
+    value = 0;
+    if(c == '-' || c == '+')
+    {
+        negative = c == '-';
+        myBad += (char) c;
+        c = get();
+    }
+    for(; c != -1 && !isSeparator(c); c = get())
+    {
+        if((int) myBad.size() < MAX_TOKEN)
+        {
+            myBad += (char) c;
+        }
+        if(c >= '0' && c <= '9' && digits < 9)
+        {
+            value = value * 10 + (c - '0');
+            digits++;
+        }
+        else
+        {
+            number = false;
+        }
+    }
+    if(!number || digits == 0)
+    {
+        return READ_BAD;
+    }
+    if(negative)
+    {
+        value = -value;
+    }
+    return READ_OK;
+}
+
+inline const string & moveReader::badToken() const
+{
+    return myBad;
+}
+
+inline bool moveReader::scripted() const
+{
+    for(size_t k = myScriptAt; k < myScript.size(); k++)
+    {
+        if(!isSeparator(myScript[k]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void moveReader::script(const string & moves)
+// postcondition: moves is read before the descriptor
+{
+    myScript = moves + ",";                  // ends its last token
+    myScriptAt = 0;
+}
+
+inline void moveReader::tie(ostream * out)
+{
+    myTie = out;
+}
+
+inline int moveReader::get()
+// postcondition: returns the next char and moves past it, -1 at the end
+{
+    int c = peek();
+    if(c != -1)
+    {
+        if(myScriptAt < myScript.size())
+        {
+            myScriptAt++;
+        }
+        else
+        {
+            myStart++;
+        }
+    }
+    return c;
+}
+
+inline int moveReader::peek()
+// postcondition: returns the next char, -1 at the end
+{
+    if(myScriptAt < myScript.size())
+    {
+        return (unsigned char) myScript[myScriptAt];
+    }
+    if(myStart == myEnd && !fill())
+    {
+        return -1;
+    }
+    return (unsigned char) myBuffer[myStart];
+}
+
+inline bool moveReader::fill()
+// postcondition: the buffer holds the next block; false at the end
+{
+    if(myEof)
+    {
+        return false;
+    }
+    if(myTie)
+    {
+        myTie->flush();
+    }
+    ssize_t got;
+    do
+    {
+        got = read(myFd, &myBuffer[0], BLOCK);
+    } while(got < 0 && errno == EINTR);
+    if(got <= 0)
+    {
+        myEof = true;
+        return false;
+    }
+    myStart = 0;
+    myEnd = (int) got;
+    return true;
+}
+
+inline bool moveReader::isSeparator(int c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ',';
+}
+
+#endif
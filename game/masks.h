@@ -0,0 +1,272 @@
+#ifndef _MASKS_H
+#define _MASKS_H
+
+#include <stdint.h>
+using namespace std;
+
+
+// fixed-width cell masks: one bit per board cell.  Boards of up to 64
+// cells use a plain unsigned integer; larger ones (15 x 15 gomoku) use
+// wideMask, an array of 64-bit words with the same operations.
+template <int W>
+struct wideMask
+{
+    uint64_t w[W];                           // word k holds cells 64k..64k+63
+
+    constexpr wideMask( ) : w{ } { }
+
+    constexpr wideMask operator & ( const wideMask & rhs ) const;
+    constexpr wideMask operator | ( const wideMask & rhs ) const;
+    constexpr wideMask operator ^ ( const wideMask & rhs ) const;
+    constexpr wideMask operator ~ ( ) const;
+    constexpr wideMask & operator |= ( const wideMask & rhs );
+    constexpr wideMask & operator &= ( const wideMask & rhs );
+    constexpr bool operator == ( const wideMask & rhs ) const;
+    constexpr bool operator != ( const wideMask & rhs ) const;
+};
+
+// maskFor<BITS>::type is the narrowest mask able to hold BITS cells
+template <int BITS, bool SMALL16 = (BITS <= 16), bool SMALL32 = (BITS <= 32),
+          bool SMALL64 = (BITS <= 64)>
+struct maskFor                 { typedef wideMask<(BITS + 63) / 64> type; };
+template <int BITS>
+struct maskFor<BITS, true, true, true>   { typedef uint16_t type; };
+template <int BITS>
+struct maskFor<BITS, false, true, true>  { typedef uint32_t type; };
+template <int BITS>
+struct maskFor<BITS, false, false, true> { typedef uint64_t type; };
+
+// maskOps<M> gives the cell-level operations for either kind of mask
+template <class M>
+struct maskOps
+{
+    static constexpr M    bit( int cell )              { return (M) ((M) 1 << cell); }
+    static constexpr M    low( int cells );            // cells 0..cells-1 set
+    static constexpr M    invert( const M & m )        { return (M) ~m; }
+    static constexpr bool test( const M & m, int cell ) { return (m >> cell) & 1; }
+    static constexpr bool any( const M & m )           { return m != 0; }
+    static int  count( const M & m )                   { return __builtin_popcountll(m); }
+    static int  first( const M & m )                   { return __builtin_ctzll(m); }
+    static void clearFirst( M & m )                    { m = (M) (m & (m - 1)); }
+    static bool less( const M & a, const M & b )       { return a < b; }
+};
+
+template <int W>
+struct maskOps< wideMask<W> >
+{
+    typedef wideMask<W> M;
+
+    static constexpr M    bit( int cell );
+    static constexpr M    low( int cells );
+    static constexpr M    invert( const M & m )        { return ~m; }
+    static constexpr bool test( const M & m, int cell ) { return (m.w[cell >> 6] >> (cell & 63)) & 1; }
+    static constexpr bool any( const M & m );
+    static int  count( const M & m );
+    static int  first( const M & m );
+    static void clearFirst( M & m );
+    static bool less( const M & a, const M & b );
+};
+
+
+// *******************************************************************
+// Specifications for mask operations
+//
+//  static M bit( int cell );
+//     precondition: 0 <= cell < number of bits in M
+//     postcondition: returns a mask with only cell set
+//
+//  static M low( int cells );
+//     precondition: 0 <= cells <= number of bits in M
+//     postcondition: returns a mask with cells 0..cells-1 set
+//
+//  static int count( const M & m );
+//     postcondition: returns the number of set cells
+//
+//  static int first( const M & m );
+//     precondition: any(m)
+//     postcondition: returns the lowest set cell
+//
+//  static void clearFirst( M & m );
+//     precondition: any(m)
+//     postcondition: the lowest set cell of m is cleared
+//
+//  static bool less( const M & a, const M & b );
+//     postcondition: returns true if a < b as unsigned numbers (used to
+//                    pick one canonical board among symmetric ones)
+//
+//  Examples of use (the same loop works for every board size):
+//
+//     for(M m = moves; maskOps<M>::any(m); maskOps<M>::clearFirst(m))
+//         play(maskOps<M>::first(m));
+
+template <class M>
+constexpr M maskOps<M>::low(int cells)
+{
+    return cells >= (int) (8 * sizeof(M)) ? (M) ~(M) 0 : (M) (((M) 1 << cells) - 1);
+}
+
+template <int W>
+constexpr wideMask<W> wideMask<W>::operator & (const wideMask<W> & rhs) const
+{
+    wideMask<W> r;
+    for(int k = 0; k < W; k++)
+    {
+        r.w[k] = w[k] & rhs.w[k];
+    }
+    return r;
+}
+
+template <int W>
+constexpr wideMask<W> wideMask<W>::operator | (const wideMask<W> & rhs) const
+{
+    wideMask<W> r;
+    for(int k = 0; k < W; k++)
+    {
+        r.w[k] = w[k] | rhs.w[k];
+    }
+    return r;
+}
+
+template <int W>
+constexpr wideMask<W> wideMask<W>::operator ^ (const wideMask<W> & rhs) const
+{
+    wideMask<W> r;
+    for(int k = 0; k < W; k++)
+    {
+        r.w[k] = w[k] ^ rhs.w[k];
+    }
+    return r;
+}
+
+template <int W>
+constexpr wideMask<W> wideMask<W>::operator ~ () const
+{
+    wideMask<W> r;
+    for(int k = 0; k < W; k++)
+    {
+        r.w[k] = ~w[k];
+    }
+    return r;
+}
+
+template <int W>
+constexpr wideMask<W> & wideMask<W>::operator |= (const wideMask<W> & rhs)
+{
+    for(int k = 0; k < W; k++)
+    {
+        w[k] |= rhs.w[k];
+    }
+    return *this;
+}
+
+template <int W>
+constexpr wideMask<W> & wideMask<W>::operator &= (const wideMask<W> & rhs)
+{
+    for(int k = 0; k < W; k++)
+    {
+        w[k] &= rhs.w[k];
+    }
+    return *this;
+}
+
+template <int W>
+constexpr bool wideMask<W>::operator == (const wideMask<W> & rhs) const
+{
+    for(int k = 0; k < W; k++)
+    {
+        if(w[k] != rhs.w[k])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <int W>
+constexpr bool wideMask<W>::operator != (const wideMask<W> & rhs) const
+{
+    return !(*this == rhs);
+}
+
+template <int W>
+constexpr wideMask<W> maskOps< wideMask<W> >::bit(int cell)
+{
+    wideMask<W> r;
+    r.w[cell >> 6] = (uint64_t) 1 << (cell & 63);
+    return r;
+}
+
+template <int W>
+constexpr wideMask<W> maskOps< wideMask<W> >::low(int cells)
+{
+    wideMask<W> r;
+    for(int k = 0; k < W; k++)
+    {
+        int left = cells - 64 * k;
+        r.w[k] = left >= 64 ? ~(uint64_t) 0 : left <= 0 ? 0 : ((uint64_t) 1 << left) - 1;
+    }
+    return r;
+}
+
+template <int W>
+constexpr bool maskOps< wideMask<W> >::any(const wideMask<W> & m)
+{
+    for(int k = 0; k < W; k++)
+    {
+        if(m.w[k])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <int W>
+int maskOps< wideMask<W> >::count(const wideMask<W> & m)
+{
+    int n = 0;
+    for(int k = 0; k < W; k++)
+    {
+        n += __builtin_popcountll(m.w[k]);
+    }
+    return n;
+}
+
+template <int W>
+int maskOps< wideMask<W> >::first(const wideMask<W> & m)
+// precondition: any(m)
+{
+    int k = 0;
+    while(m.w[k] == 0)
+    {
+        k++;
+    }
+    return 64 * k + __builtin_ctzll(m.w[k]);
+}
+
+template <int W>
+void maskOps< wideMask<W> >::clearFirst(wideMask<W> & m)
+// precondition: any(m)
+{
+    int k = 0;
+    while(m.w[k] == 0)
+    {
+        k++;
+    }
+    m.w[k] &= m.w[k] - 1;
+}
+
+template <int W>
+bool maskOps< wideMask<W> >::less(const wideMask<W> & a, const wideMask<W> & b)
+{
+    for(int k = W - 1; k >= 0; k--)
+    {
+        if(a.w[k] != b.w[k])
+        {
+            return a.w[k] < b.w[k];
+        }
+    }
+    return false;
+}
+
+#endif
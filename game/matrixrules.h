@@ -0,0 +1,183 @@
+#ifndef _MATRIXRULES_H
+#define _MATRIXRULES_H
+
+#include "../m/matrix.h"
+#include "winlines.h"
+using namespace std;
+
+
+// runtime-sized N x N, K-in-a-row rules on a matrix<itemType>.
+// This is the fallback for sizes that have no nkBoard instantiation;
+// it scans outward from the last move instead of using line tables.
+template <class itemType>
+class matrixRules
+{
+  public:
+
+  // constructor
+    matrixRules( int size, int run,
+                 const itemType & empty,
+                 const itemType & first );   // first player's mark
+
+  // accessors
+    int size( ) const;                       // rows == cols
+    int run( ) const;                        // marks in a row to win
+
+  // rules
+    bool validMove( const matrix<itemType> & board, int r, int c ) const;
+    bool winsThrough( const matrix<itemType> & board, int r, int c ) const;
+    gameResult resultAfter( const matrix<itemType> & board,
+                            int r, int c, int moves ) const;
+    gameResult resultOf( const matrix<itemType> & board ) const;
+
+  private:
+
+    int runLength( const matrix<itemType> & board, int r, int c,
+                   int dr, int dc ) const;
+
+    int mySize;                              // rows == cols
+    int myRun;                               // K
+    itemType myEmpty;                        // what an open cell holds
+    itemType myFirst;                        // mark that means X_WINS
+};
+
+
+// *******************************************************************
+// Specifications for matrixRules functions
+//
+//  matrixRules( int size, int run, const itemType & empty,
+//               const itemType & first );
+//     precondition: 1 <= run <= size
+//     postcondition: rules for a size x size board, run in a row wins;
+//                    empty marks an open cell and a win by first is
+//                    reported as X_WINS (anything else as O_WINS)
+//
+//  bool validMove( const matrix<itemType> & board, int r, int c ) const;
+//     postcondition: returns true if (r,c) is on the board and open
+//
+//  bool winsThrough( const matrix<itemType> & board, int r, int c ) const;
+//     precondition: (r,c) is on the board and not empty
+//     postcondition: returns true if board[r][c] is part of run equal
+//                    marks along a row, column or diagonal
+//
+//  gameResult resultAfter( const matrix<itemType> & board,
+//                          int r, int c, int moves ) const;
+//     precondition: (r,c) was just marked, moves marks are on the board
+//     postcondition: returns the win for the mover, DRAW or ONGOING
+//
+//  gameResult resultOf( const matrix<itemType> & board ) const;
+//     postcondition: returns the result of an arbitrary position
+
+template <class itemType>
+matrixRules<itemType>::matrixRules(int size, int run,
+                                   const itemType & empty,
+                                   const itemType & first)
+    : mySize(size),
+      myRun(run),
+      myEmpty(empty),
+      myFirst(first)
+{
+
+}
+
+template <class itemType>
+int matrixRules<itemType>::size() const
+{
+    return mySize;
+}
+
+template <class itemType>
+int matrixRules<itemType>::run() const
+{
+    return myRun;
+}
+
+template <class itemType>
+bool matrixRules<itemType>::validMove(const matrix<itemType> & board,
+                                      int r, int c) const
+// postcondition: returns true if (r,c) is on the board and open
+{
+    if(r < 0 || r >= mySize || c < 0 || c >= mySize)
+    {
+        return false;
+    }
+    return board[r][c] == myEmpty;
+}
+
+template <class itemType>
+int matrixRules<itemType>::runLength(const matrix<itemType> & board,
+                                     int r, int c, int dr, int dc) const
+// postcondition: returns how many cells past (r,c) in direction (dr,dc)
+//                hold the same mark as (r,c)
+{
+    const itemType & p = board[r][c];
+    int n = 0;
+    r += dr;
+    c += dc;
+    while(r >= 0 && r < mySize && c >= 0 && c < mySize && board[r][c] == p)
+    {
+        n++;
+        r += dr;
+        c += dc;
+    }
+    return n;
+}
+
+template <class itemType>
+bool matrixRules<itemType>::winsThrough(const matrix<itemType> & board,
+                                        int r, int c) const
+// postcondition: returns true if board[r][c] is part of a winning run
+{
+    const int dr[4] = { 0, 1, 1, 1 };
+    const int dc[4] = { 1, 0, 1, -1 };
+    int d;
+    for(d = 0; d < 4; d++)
+    {
+        int n = 1 + runLength(board, r, c, dr[d], dc[d])
+                  + runLength(board, r, c, -dr[d], -dc[d]);
+        if(n >= myRun)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class itemType>
+gameResult matrixRules<itemType>::resultAfter(const matrix<itemType> & board,
+                                              int r, int c, int moves) const
+// precondition: (r,c) was just marked, moves marks are on the board
+// postcondition: returns the win for the mover, DRAW or ONGOING
+{
+    if(winsThrough(board, r, c))
+    {
+        return board[r][c] == myFirst ? X_WINS : O_WINS;
+    }
+    return moves >= mySize * mySize ? DRAW : ONGOING;
+}
+
+template <class itemType>
+gameResult matrixRules<itemType>::resultOf(const matrix<itemType> & board) const
+// postcondition: returns the result of an arbitrary position
+{
+    int r, c;
+    int moves = 0;
+    for(r = 0; r < mySize; r++)
+    {
+        for(c = 0; c < mySize; c++)
+        {
+            if(board[r][c] == myEmpty)
+            {
+                continue;
+            }
+            moves++;
+            if(winsThrough(board, r, c))
+            {
+                return board[r][c] == myFirst ? X_WINS : O_WINS;
+            }
+        }
+    }
+    return moves >= mySize * mySize ? DRAW : ONGOING;
+}
+
+#endif
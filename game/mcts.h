@@ -0,0 +1,479 @@
+#ifndef _MCTS_H
+#define _MCTS_H
+
+#include <chrono>
+#include <cmath>
+#include <stdint.h>
+#include "winlines.h"
+#include "rng.h"
+#include "workpool.h"
+#include "../m/mlist.h"
+using namespace std;
+
+
+// how long mcts may think about one move.  The search stops at whichever
+// of iterations and milliseconds runs out first; 0 turns a limit off
+// (at least one must be set).
+struct mctsLimits
+{
+    long long iterations;                    // playouts per move, all trees
+    int milliseconds;                        // wall-clock time per move
+    int threads;                             // trees searched in parallel
+    int nodes;                               // node pool size per tree
+
+    mctsLimits( ) : iterations(20000), milliseconds(0), threads(1), nodes(1 << 20) { }
+};
+
+// Monte Carlo tree search (UCT) player for boards too big to solve.
+// Each thread grows its own tree from the root (root parallelism) out
+// of a preallocated node pool, leaves are valued by random playouts on
+// the packed board, and the move with the most visits summed over all
+// trees is played.  Boards bigger than 7 x 7 only consider cells within
+// two of a mark, which keeps the tree narrow on gomoku boards.
+template <int N, int K>
+class mcts
+{
+  public:
+
+    typedef nkBoard<N, K> board;
+    typedef typename board::mask mask;
+    typedef typename board::ops ops;
+    typedef typename board::rules rules;
+
+    static constexpr int CELLS = N * N;
+    static constexpr int RADIUS = 2;         // candidate distance on big boards
+
+  // constructor/destructor
+    explicit mcts( const mctsLimits & limits );
+    ~mcts( );
+
+  // searching
+    int bestMove( const board & pos );       // move for pos.toMove()
+
+  // accessors
+    long long playouts( ) const;             // in the last search
+    int trees( ) const;                      // searched in parallel
+
+  // modifiers
+    void reseed( uint64_t seed );            // same seed, same moves
+
+  private:
+
+    struct node
+    {
+        int firstChild;                      // pool index, -1 until expanded
+        int numChildren;
+        int visits;
+        int score;                           // half points for the player
+        int cell;                            // who moved into this node
+    };
+
+    struct tree
+    {
+        mlist<node> pool;                    // preallocated node pool
+        int used;                            // next free node
+        fastRng rng;
+        long long playouts;
+
+        tree( ) : used(0), rng(1), playouts(0) { }
+    };
+
+    typedef chrono::steady_clock clock;
+
+    void search( tree & t, const board & pos, long long iterations,
+                 clock::time_point deadline );
+    void iterate( tree & t, const board & pos );
+    bool expand( tree & t, int n, const board & pos );
+    int select( const tree & t, int n ) const;
+    gameResult playout( board & pos, char p, fastRng & rng ) const;
+    mask candidates( const board & pos ) const;
+
+    mcts( const mcts & );                    // not copyable
+    void operator = ( const mcts & );
+
+    mctsLimits myLimits;
+    mlist<tree> myTrees;                     // one per thread
+    mask myNear[CELLS];                      // cells within RADIUS of each cell
+    workPool * myPool;                       // 0 when single threaded
+    long long myPlayouts;
+};
+
+
+// *******************************************************************
+// Specifications for mcts functions
+//
+//  explicit mcts( const mctsLimits & limits );
+//     precondition: limits.iterations > 0 or limits.milliseconds > 0;
+//                   limits.nodes > CELLS
+//     postcondition: a player with limits.threads trees (one per core
+//                    when 0); node pools are allocated on first use
+//
+//  int bestMove( const board & pos );
+//     precondition: resultOf(pos) == ONGOING
+//     postcondition: returns an open cell: a winning cell if there is
+//                    one, else a cell that blocks the opponent's win,
+//                    else the most visited root move after the search
+//
+//  long long playouts( ) const;
+//     postcondition: returns the number of playouts the last bestMove
+//                    ran over all trees
+//
+//  void reseed( uint64_t seed );
+//     postcondition: tree k's generator restarts from seed + k; with an
+//                    iteration limit (and no time limit) the moves are
+//                    then repeatable for any thread count
+//
+//  Search notes: a node is expanded the second time it is reached, when
+//  the pool still has room for all of its children; until then, and
+//  when the pool is full, the leaf is valued by a playout.  Children
+//  are shuffled on expansion and chosen by UCB1 (unvisited first).
+//
+//  Examples of use:
+//
+//     mctsLimits limits;
+//     limits.milliseconds = 1000;
+//     limits.threads = 0;                   // every core
+//     mcts<15,5> brain(limits);
+//     int cell = brain.bestMove(pos);
+
+template <int N, int K>
+mcts<N, K>::mcts(const mctsLimits & limits)
+    : myLimits(limits),
+      myPool(0),
+      myPlayouts(0)
+{
+    if(limits.iterations <= 0 && limits.milliseconds <= 0)
+    {
+        cerr << "mcts needs an iteration or time limit" << endl;
+        exit(1);
+    }
+    if(limits.nodes <= CELLS)
+    {
+        cerr << "mcts node pool of " << limits.nodes << " is too small" << endl;
+        exit(1);
+    }
+    if(limits.threads != 1)
+    {
+        myPool = new workPool(limits.threads);
+    }
+    myTrees.resize(myPool ? myPool->size() : 1);
+    reseed(1);
+
+    for(int c = 0; c < CELLS; c++)
+    {
+        myNear[c] = mask{ };
+        for(int d = 0; d < CELLS; d++)
+        {
+            if(abs(board::rowOf(c) - board::rowOf(d)) <= RADIUS &&
+               abs(board::colOf(c) - board::colOf(d)) <= RADIUS)
+            {
+                myNear[c] |= ops::bit(d);
+            }
+        }
+    }
+}
+
+template <int N, int K>
+mcts<N, K>::~mcts()
+{
+    delete myPool;
+}
+
+template <int N, int K>
+long long mcts<N, K>::playouts() const
+{
+    return myPlayouts;
+}
+
+template <int N, int K>
+int mcts<N, K>::trees() const
+{
+    return myTrees.size();
+}
+
+template <int N, int K>
+void mcts<N, K>::reseed(uint64_t seed)
+// postcondition: tree k's generator restarts from seed + k
+{
+    for(int k = 0; k < myTrees.size(); k++)
+    {
+        myTrees[k].rng.reseed(seed + k);
+    }
+}
+
+template <int N, int K>
+int mcts<N, K>::bestMove(const board & pos)
+// precondition: resultOf(pos) == ONGOING
+// postcondition: returns an open cell for pos.toMove()
+{
+    char p = pos.toMove();
+    char q = (p == 'x') ? 'o' : 'x';
+    mask open = pos.legalMoves();
+    mask m;
+
+    // a playout budget is wasted on moves that are forced
+    for(m = open; ops::any(m); ops::clearFirst(m))
+    {
+        int c = ops::first(m);
+        if(rules::winsThrough((mask) (pos.marks(p) | ops::bit(c)), c))
+        {
+            return c;
+        }
+    }
+    for(m = open; ops::any(m); ops::clearFirst(m))
+    {
+        int c = ops::first(m);
+        if(rules::winsThrough((mask) (pos.marks(q) | ops::bit(c)), c))
+        {
+            return c;
+        }
+    }
+
+    int numTrees = myTrees.size();
+    long long share = (myLimits.iterations + numTrees - 1) / numTrees;
+    clock::time_point deadline = clock::time_point::max();
+    if(myLimits.milliseconds > 0)
+    {
+        deadline = clock::now() + chrono::milliseconds(myLimits.milliseconds);
+    }
+
+    if(myPool)
+    {
+        for(int k = 0; k < numTrees; k++)
+        {
+            myPool->submit([this, k, &pos, share, deadline](int) {
+                search(myTrees[k], pos, share, deadline);
+            });
+        }
+        myPool->wait();
+    }
+    else
+    {
+        search(myTrees[0], pos, share, deadline);
+    }
+
+    // sum the root visits of every tree
+    long long visits[CELLS] = { };
+    myPlayouts = 0;
+    for(int k = 0; k < numTrees; k++)
+    {
+        const tree & t = myTrees[k];
+        const node & root = t.pool[0];
+        for(int j = 0; j < root.numChildren; j++)
+        {
+            const node & child = t.pool[root.firstChild + j];
+            visits[child.cell] += child.visits;
+        }
+        myPlayouts += t.playouts;
+    }
+
+    int best = ops::first(open);
+    for(int c = 0; c < CELLS; c++)
+    {
+        if(visits[c] > visits[best])
+        {
+            best = c;
+        }
+    }
+    return best;
+}
+
+template <int N, int K>
+void mcts<N, K>::search(tree & t, const board & pos, long long iterations,
+                        clock::time_point deadline)
+// postcondition: t holds a fresh tree for pos grown by up to iterations
+//                playouts (no limit when iterations <= 0) or until deadline
+{
+    if(t.pool.size() == 0)
+    {
+        t.pool.resize(myLimits.nodes);
+    }
+    t.used = 1;
+    t.playouts = 0;
+    node & root = t.pool[0];
+    root.firstChild = -1;
+    root.numChildren = 0;
+    root.visits = 0;
+    root.score = 0;
+    root.cell = -1;
+    expand(t, 0, pos);
+
+    for(long long k = 0; iterations <= 0 || k < iterations; k++)
+    {
+        if((k & 63) == 0 && clock::now() >= deadline)
+        {
+            break;
+        }
+        iterate(t, pos);
+        t.playouts++;
+    }
+}
+
+template <int N, int K>
+void mcts<N, K>::iterate(tree & t, const board & pos)
+// postcondition: one selection, expansion, playout and backup step
+{
+    board b = pos;
+    char p = b.toMove();
+    int path[CELLS + 1];
+    char mover[CELLS + 1];
+    int depth = 0;
+    int n = 0;
+    gameResult result = ONGOING;
+    path[0] = 0;
+
+    while(result == ONGOING)
+    {
+        node & here = t.pool[n];
+        if(here.firstChild < 0 && (here.visits == 0 || !expand(t, n, b)))
+        {
+            break;                           // leaf: value it by a playout
+        }
+        n = select(t, n);
+        int cell = t.pool[n].cell;
+        b.apply(cell, p);
+        result = resultAfter(b, cell, p);
+        depth++;
+        path[depth] = n;
+        mover[depth] = p;
+        p = (p == 'x') ? 'o' : 'x';
+    }
+
+    if(result == ONGOING)
+    {
+        result = playout(b, p, t.rng);
+    }
+
+    t.pool[0].visits++;
+    for(int d = 1; d <= depth; d++)
+    {
+        node & x = t.pool[path[d]];
+        x.visits++;
+        if(result == winFor(mover[d]))
+        {
+            x.score += 2;
+        }
+        else if(result == DRAW)
+        {
+            x.score += 1;
+        }
+    }
+}
+
+template <int N, int K>
+bool mcts<N, K>::expand(tree & t, int n, const board & pos)
+// postcondition: if the pool had room, node n has one child per
+//                candidate move, in random order, and true is returned
+{
+    mask cells = candidates(pos);
+    int count = ops::count(cells);
+    if(count == 0 || t.used + count > t.pool.size())
+    {
+        return false;
+    }
+
+    int first = t.used;
+    t.used += count;
+    for(int k = 0; k < count; k++, ops::clearFirst(cells))
+    {
+        node & child = t.pool[first + k];
+        child.firstChild = -1;
+        child.numChildren = 0;
+        child.visits = 0;
+        child.score = 0;
+        child.cell = ops::first(cells);
+    }
+    for(int k = count - 1; k > 0; k--)       // shuffle so ties break randomly
+    {
+        int j = t.rng.below(k + 1);
+        int c = t.pool[first + k].cell;
+        t.pool[first + k].cell = t.pool[first + j].cell;
+        t.pool[first + j].cell = c;
+    }
+
+    t.pool[n].firstChild = first;
+    t.pool[n].numChildren = count;
+    return true;
+}
+
+template <int N, int K>
+int mcts<N, K>::select(const tree & t, int n) const
+// precondition: node n is expanded
+// postcondition: returns the child with the highest UCB1 value
+{
+    const double C = 1.4;
+    const node & parent = t.pool[n];
+    double logVisits = log((double) parent.visits + 1.0);
+    int best = parent.firstChild;
+    double bestValue = -1.0;
+
+    for(int k = 0; k < parent.numChildren; k++)
+    {
+        int c = parent.firstChild + k;
+        const node & child = t.pool[c];
+        if(child.visits == 0)
+        {
+            return c;
+        }
+        double value = child.score / (2.0 * child.visits) +
+                       C * sqrt(logVisits / child.visits);
+        if(value > bestValue)
+        {
+            bestValue = value;
+            best = c;
+        }
+    }
+    return best;
+}
+
+template <int N, int K>
+gameResult mcts<N, K>::playout(board & pos, char p, fastRng & rng) const
+// precondition: resultOf(pos) == ONGOING, p is to move
+// postcondition: pos has been played out at random to the end; returns
+//                the result
+{
+    int open[CELLS];
+    int numOpen = 0;
+    for(mask m = pos.legalMoves(); ops::any(m); ops::clearFirst(m))
+    {
+        open[numOpen++] = ops::first(m);
+    }
+
+    gameResult result = ONGOING;
+    while(result == ONGOING)
+    {
+        int k = rng.below(numOpen);          // take a random open cell and
+        int cell = open[k];                  // fill its slot from the end
+        open[k] = open[--numOpen];
+        pos.apply(cell, p);
+        result = resultAfter(pos, cell, p);
+        p = (p == 'x') ? 'o' : 'x';
+    }
+    return result;
+}
+
+template <int N, int K>
+typename mcts<N, K>::mask mcts<N, K>::candidates(const board & pos) const
+// postcondition: returns the moves worth a child node: every open cell
+//                on boards up to 7 x 7, else the open cells near a mark
+//                (the center on an empty board)
+{
+    mask open = pos.legalMoves();
+    if(N <= 7)
+    {
+        return open;
+    }
+    mask taken = pos.occupied();
+    if(!ops::any(taken))
+    {
+        return ops::bit(board::cellOf(N / 2, N / 2));
+    }
+    mask near{ };
+    for(mask m = taken; ops::any(m); ops::clearFirst(m))
+    {
+        near |= myNear[ops::first(m)];
+    }
+    return (mask) (near & open);
+}
+
+#endif
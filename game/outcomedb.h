@@ -0,0 +1,217 @@
+#ifndef _OUTCOMEDB_H
+#define _OUTCOMEDB_H
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "winlines.h"
+using namespace std;
+
+
+// complete 3 x 3 outcome database.  The file is a header followed by
+// one 4-byte record for every base-3 board index (3^9 = 19683), so a
+// query is a single array lookup into the memory-mapped file.  Boards
+// that cannot arise in a game have value DB_UNREACHABLE.
+//
+// file layout (native byte order, since the records are used straight
+// from the mapping; a file from a machine of the other order has a
+// byte-swapped version and open() turns it down):
+//   dbHeader                 16 bytes
+//   dbRecord[DB_RECORDS]      4 bytes each
+
+enum dbValue
+{
+    DB_UNREACHABLE,                          // not a legal game position
+    DB_WIN,                                  // side to move wins
+    DB_DRAW,                                 // perfect play draws
+    DB_LOSS                                  // side to move loses
+};
+
+const int DB_RECORDS = 19683;                // 3^9
+const char DB_MAGIC[8] = { 'T', 'T', 'T', 'D', 'B', '3', 'x', '3' };
+const uint32_t DB_VERSION = 1;
+
+struct dbHeader
+{
+    char     magic[8];                       // DB_MAGIC
+    uint32_t version;                        // DB_VERSION
+    uint32_t positions;                      // reachable records
+};
+
+struct dbRecord
+{
+    uint8_t  value;                          // a dbValue
+    uint8_t  distance;                       // plies to the end, perfect play
+    uint16_t bestMoves;                      // cells that keep the value
+};
+
+static_assert(sizeof(dbHeader) == 16 && sizeof(dbRecord) == 4,
+              "the structs are the file layout");
+
+// base-3 digit weight of every 9-bit mask: index = B3[x] + 2 * B3[o]
+struct base3Table
+{
+    uint16_t weight[512];
+
+    constexpr base3Table( );
+};
+
+int base3Index( const bitboard & pos );
+
+class outcomeDb
+{
+  public:
+
+  // constructors/destructor
+    outcomeDb( );                            // nothing loaded
+    ~outcomeDb( );                           // unmaps the file
+
+  // loading
+    bool open( const char * path );          // mmap a database file
+    bool isOpen( ) const;
+
+  // queries
+    const dbRecord & lookup( const bitboard & pos ) const;
+    int bestMove( const bitboard & pos ) const;
+
+  private:
+
+    outcomeDb( const outcomeDb & );          // not copyable
+    void operator = ( const outcomeDb & );
+
+    void * myMap;                            // the whole file
+    size_t myLength;                         // bytes mapped
+    const dbRecord * myRecords;              // records inside myMap
+};
+
+
+// *******************************************************************
+// Specifications for outcomeDb functions
+//
+//  int base3Index( const bitboard & pos );
+//     postcondition: returns sum over cells of digit * 3^cell, digit 0 for
+//                    open, 1 for 'x', 2 for 'o' (two table lookups)
+//
+//  bool open( const char * path );
+//     postcondition: if path is a database file of the right size and
+//                    version it is mapped read-only and true is returned;
+//                    otherwise nothing is loaded and false is returned
+//
+//  const dbRecord & lookup( const bitboard & pos ) const;
+//     precondition: isOpen()
+//     postcondition: returns the record for pos; value, distance and
+//                    bestMoves are for pos.toMove()
+//
+//  int bestMove( const bitboard & pos ) const;
+//     precondition: isOpen(), resultOf(pos) == ONGOING
+//     postcondition: returns one of the best moves of pos
+//
+//  Examples of use:
+//
+//     outcomeDb db;
+//     if(db.open("ttt3x3.db"))
+//         cell = db.bestMove(pos);          // no search at all
+
+constexpr base3Table::base3Table()
+    : weight{ }
+{
+    for(int m = 0; m < 512; m++)
+    {
+        int w = 0;
+        int p = 1;
+        for(int cell = 0; cell < 9; cell++)
+        {
+            if(m & (1 << cell))
+            {
+                w += p;
+            }
+            p *= 3;
+        }
+        weight[m] = (uint16_t) w;
+    }
+}
+
+inline constexpr base3Table BASE3 = base3Table();
+
+inline int base3Index(const bitboard & pos)
+// postcondition: returns the base-3 index of pos
+{
+    return BASE3.weight[pos.marks('x')] + 2 * BASE3.weight[pos.marks('o')];
+}
+
+inline outcomeDb::outcomeDb()
+    : myMap(0),
+      myLength(0),
+      myRecords(0)
+{
+
+}
+
+inline outcomeDb::~outcomeDb()
+{
+    if(myMap)
+    {
+        munmap(myMap, myLength);
+    }
+}
+
+inline bool outcomeDb::open(const char * path)
+// postcondition: the file is mapped if it is a valid database
+{
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    size_t want = sizeof(dbHeader) + DB_RECORDS * sizeof(dbRecord);
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size != want)
+    {
+        ::close(fd);
+        return false;
+    }
+    void * map = mmap(0, want, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);                             // the mapping stays valid
+    if(map == MAP_FAILED)
+    {
+        return false;
+    }
+    const dbHeader * h = (const dbHeader *) map;
+    if(memcmp(h->magic, DB_MAGIC, sizeof(DB_MAGIC)) != 0 || h->version != DB_VERSION)
+    {
+        munmap(map, want);
+        return false;
+    }
+    if(myMap)
+    {
+        munmap(myMap, myLength);
+    }
+    myMap = map;
+    myLength = want;
+    myRecords = (const dbRecord *) ((const char *) map + sizeof(dbHeader));
+    return true;
+}
+
+inline bool outcomeDb::isOpen() const
+{
+    return myRecords != 0;
+}
+
+inline const dbRecord & outcomeDb::lookup(const bitboard & pos) const
+// precondition: isOpen()
+// postcondition: returns the record for pos
+{
+    return myRecords[base3Index(pos)];
+}
+
+inline int outcomeDb::bestMove(const bitboard & pos) const
+// precondition: isOpen(), pos is ongoing
+// postcondition: returns one of the best moves of pos
+{
+    return bitboard::firstCell(lookup(pos).bestMoves);
+}
+
+#endif
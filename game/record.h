@@ -0,0 +1,375 @@
+#ifndef _RECORD_H
+#define _RECORD_H
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <mutex>
+#include "winlines.h"
+using namespace std;
+
+
+// binary game records.  A record file is a header followed by games
+// packed back to back, each a 4-byte game header and one byte per move
+// (the cell, row * size + col), so a 3 x 3 game takes at most 13 bytes.
+// Files are only ever appended to, each batch of games with a single
+// write(2) on an O_APPEND descriptor, and are read back through mmap so
+// archives of any size can be scanned without loading them.  A writer
+// killed part way through a write leaves a cut-off game at the end; the
+// next open cuts the file back to its last whole game.
+//
+// file layout:
+//   recHeader                16 bytes
+//   recGame + moves          4 + moves bytes, repeated
+
+const char REC_MAGIC[8] = { 'T', 'T', 'T', 'G', 'A', 'M', 'E', 'S' };
+const uint32_t REC_VERSION = 1;
+const int REC_MAX_SIZE = 15;                 // cells and move counts fit a byte
+const int REC_MAX_BYTES = 4 + REC_MAX_SIZE * REC_MAX_SIZE;   // largest game
+
+struct recHeader
+{
+    char     magic[8];                       // REC_MAGIC
+    uint32_t version;                        // REC_VERSION
+    uint32_t reserved;                       // 0
+};
+
+struct recGame
+{
+    uint8_t  size;                           // rows == cols
+    uint8_t  run;                            // marks in a row to win
+    uint8_t  moves;                          // cells that follow
+    uint8_t  result;                         // a gameResult
+};
+
+// one game inside a mapped file
+struct recView
+{
+    int size;
+    int run;
+    int numMoves;
+    gameResult result;
+    const uint8_t * moves;                   // numMoves cells, 'x' moves first
+};
+
+// appends games to a record file; safe to share between threads
+class recordWriter
+{
+  public:
+
+  // constructor/destructor
+    recordWriter( );
+    ~recordWriter( );                        // closes
+
+  // opening
+    bool open( const char * path );          // create, or append to a record file
+    bool isOpen( ) const;
+    void close( );
+
+  // writing
+    bool write( int size, int run, const uint8_t * moves, int numMoves,
+                gameResult result );
+    bool append( const uint8_t * bytes, size_t length );   // encoded games
+    static int encode( uint8_t * out, int size, int run,
+                       const uint8_t * moves, int numMoves, gameResult result );
+
+  private:
+
+    recordWriter( const recordWriter & );    // not copyable
+    void operator = ( const recordWriter & );
+
+    int myFd;                                // O_APPEND, -1 when closed
+    mutex myLock;                            // one game's bytes stay together
+};
+
+// memory-mapped, read-only view of a record file
+class recordReader
+{
+  public:
+
+  // constructor/destructor
+    recordReader( );
+    ~recordReader( );                        // unmaps the file
+
+  // opening
+    bool open( const char * path );
+    bool isOpen( ) const;
+
+  // reading
+    size_t begin( ) const;                   // offset of the first game
+    size_t end( ) const;                     // file length
+    bool next( size_t & offset, recView & game ) const;
+
+  private:
+
+    recordReader( const recordReader & );    // not copyable
+    void operator = ( const recordReader & );
+
+    void * myMap;                            // the whole file
+    size_t myLength;                         // bytes mapped
+};
+
+
+// *******************************************************************
+// Specifications for record functions
+//
+//  bool recordWriter::open( const char * path );
+//     postcondition: path is open for appending and true is returned; a
+//                    new or empty file gets a header first, an existing
+//                    one must already start with a valid header and is
+//                    cut back to the end of its last whole game (found
+//                    by walking the game headers)
+//
+//  bool write( int size, int run, const uint8_t * moves, int numMoves,
+//              gameResult result );
+//     precondition: isOpen(), 1 <= run <= size <= REC_MAX_SIZE,
+//                   0 <= numMoves <= size * size
+//     postcondition: the game has been written to the file as one
+//                    piece; returns false on a write error
+//
+//  bool append( const uint8_t * bytes, size_t length );
+//     precondition: bytes holds whole games made by encode
+//     postcondition: the games are appended with one write(2) (more
+//                    only if the kernel takes part of them), so threads
+//                    can encode batches on their own and append them
+//
+//  static int encode( uint8_t * out, ... );
+//     precondition: out has room for 4 + numMoves bytes
+//     postcondition: out holds the game; returns its length
+//
+//  bool recordReader::open( const char * path );
+//     postcondition: if path starts with a valid header it is mapped and
+//                    true is returned
+//
+//  bool next( size_t & offset, recView & game ) const;
+//     precondition: offset is begin() or was set by next
+//     postcondition: if a whole game starts at offset, game views it,
+//                    offset moves past it and true is returned; returns
+//                    false at the end of the file or on a cut-off game
+//                    (offset < end() tells the two apart)
+//
+//  Examples of use:
+//
+//     recordWriter out;
+//     out.open("games.rec");
+//     out.write(3, 3, moves, numMoves, result);
+//
+//     recordReader in;
+//     in.open("games.rec");
+//     recView game;
+//     for(size_t at = in.begin(); in.next(at, game); )
+//         replay(game);
+
+inline recordWriter::recordWriter()
+    : myFd(-1)
+{
+
+}
+
+inline recordWriter::~recordWriter()
+{
+    close();
+}
+
+inline bool recordWriter::open(const char * path)
+// postcondition: path is open for appending, cut back to its last whole game
+{
+    close();
+    int fd = ::open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0)
+    {
+        if(fd >= 0)
+        {
+            ::close(fd);
+        }
+        return false;
+    }
+    if(st.st_size == 0)
+    {
+        recHeader h;
+        memcpy(h.magic, REC_MAGIC, sizeof(REC_MAGIC));
+        h.version = REC_VERSION;
+        h.reserved = 0;
+        if(::write(fd, &h, sizeof(h)) != (ssize_t) sizeof(h))
+        {
+            ::close(fd);
+            return false;
+        }
+    }
+    else
+    {
+        recordReader in;                     // checks the header
+        if(!in.open(path))
+        {
+            ::close(fd);
+            return false;
+        }
+        recView game;
+        size_t at = in.begin();
+        while(in.next(at, game))
+        {
+            // hop over the whole games
+        }
+        if(at < in.end() && ftruncate(fd, (off_t) at) != 0)
+        {
+            ::close(fd);                     // can't drop the torn game
+            return false;
+        }
+    }
+    myFd = fd;
+    return true;
+}
+
+inline bool recordWriter::isOpen() const
+{
+    return myFd >= 0;
+}
+
+inline void recordWriter::close()
+{
+    if(myFd >= 0)
+    {
+        ::close(myFd);
+        myFd = -1;
+    }
+}
+
+inline int recordWriter::encode(uint8_t * out, int size, int run,
+                                const uint8_t * moves, int numMoves, gameResult result)
+// postcondition: out holds the game; returns its length
+{
+    out[0] = (uint8_t) size;
+    out[1] = (uint8_t) run;
+    out[2] = (uint8_t) numMoves;
+    out[3] = (uint8_t) result;
+    memcpy(out + 4, moves, numMoves);
+    return 4 + numMoves;
+}
+
+inline bool recordWriter::write(int size, int run, const uint8_t * moves,
+                                int numMoves, gameResult result)
+// precondition: isOpen(), size <= REC_MAX_SIZE
+{
+    uint8_t bytes[REC_MAX_BYTES];
+    int length = encode(bytes, size, run, moves, numMoves, result);
+    return append(bytes, length);
+}
+
+inline bool recordWriter::append(const uint8_t * bytes, size_t length)
+// postcondition: the games are appended as one piece
+{
+    lock_guard<mutex> guard(myLock);
+    if(myFd < 0)
+    {
+        return false;
+    }
+    while(length > 0)                        // normally one pass
+    {
+        ssize_t wrote = ::write(myFd, bytes, length);
+        if(wrote < 0 && errno != EINTR)
+        {
+            return false;
+        }
+        if(wrote > 0)
+        {
+            bytes += wrote;
+            length -= (size_t) wrote;
+        }
+    }
+    return true;
+}
+
+inline recordReader::recordReader()
+    : myMap(0),
+      myLength(0)
+{
+
+}
+
+inline recordReader::~recordReader()
+{
+    if(myMap)
+    {
+        munmap(myMap, myLength);
+    }
+}
+
+inline bool recordReader::open(const char * path)
+// postcondition: the file is mapped if it starts with a valid header
+{
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(recHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+    size_t length = (size_t) st.st_size;
+    void * map = mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);                             // the mapping stays valid
+    if(map == MAP_FAILED)
+    {
+        return false;
+    }
+    const recHeader * h = (const recHeader *) map;
+    if(memcmp(h->magic, REC_MAGIC, sizeof(REC_MAGIC)) != 0 || h->version != REC_VERSION)
+    {
+        munmap(map, length);
+        return false;
+    }
+    madvise(map, length, MADV_SEQUENTIAL);  // read once, front to back
+    if(myMap)
+    {
+        munmap(myMap, myLength);
+    }
+    myMap = map;
+    myLength = length;
+    return true;
+}
+
+inline bool recordReader::isOpen() const
+{
+    return myMap != 0;
+}
+
+inline size_t recordReader::begin() const
+{
+    return sizeof(recHeader);
+}
+
+inline size_t recordReader::end() const
+{
+    return myLength;
+}
+
+inline bool recordReader::next(size_t & offset, recView & game) const
+// postcondition: game views the game at offset, offset is past it
+{
+    if(offset + sizeof(recGame) > myLength)
+    {
+        return false;
+    }
+    const uint8_t * p = (const uint8_t *) myMap + offset;
+    if(offset + sizeof(recGame) + p[2] > myLength)
+    {
+        return false;                        // cut off in the middle
+    }
+    game.size = p[0];
+    game.run = p[1];
+    game.numMoves = p[2];
+    game.result = (gameResult) p[3];
+    game.moves = p + sizeof(recGame);
+    offset += sizeof(recGame) + p[2];
+    return true;
+}
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef _RENDER_H
+#define _RENDER_H
+
+#include <iostream>
+#include <string>
+#include "bitboard.h"
+#include "../m/matrix.h"
+using namespace std;
+
+
+// board output formats
+enum renderFormat
+{
+    RENDER_COMPACT,                          // |x|o| | rows, as show() printed
+    RENDER_ANSI,                             // compact with coloured marks
+    RENDER_FEN                               // one line: xo1/3/2o x
+};
+
+// formats a whole board into a buffer that is reused from board to
+// board, so streaming many boards costs one ostream::write each and no
+// allocation once the buffer has grown to the largest board
+class boardRenderer
+{
+  public:
+
+  // constructor
+    explicit boardRenderer( renderFormat format = RENDER_COMPACT,
+                            int maxSize = 15 );  // room for maxSize^2 cells
+
+  // formatting
+    int render( const matrix<char> & board, char empty );
+    template <int N, int K>
+    int render( const nkBoard<N, K> & pos );
+    void write( ostream & out ) const;       // the last board, one write
+
+  // accessors
+    const char * text( ) const;              // the last board
+    int length( ) const;                     // its length in chars
+    renderFormat format( ) const;
+
+  // modifiers
+    void setFormat( renderFormat format );
+
+    static bool parseFormat( const string & name, renderFormat & format );
+
+  private:
+
+    template <class cellFunc>
+    int renderCells( int rows, int cols, char empty, cellFunc cellAt );
+    void put( char c );
+    void put( const char * s );
+    void putCount( int n );                  // n >= 1, in decimal
+    void reserve( int chars );
+
+    mlist<char> myBuffer;                    // capacity, not text length
+    int myLength;                            // chars of the last board
+    renderFormat myFormat;
+};
+
+
+// *******************************************************************
+// Specifications for boardRenderer functions
+//
+//  explicit boardRenderer( renderFormat format, int maxSize );
+//     precondition: maxSize >= 1
+//     postcondition: renderer whose buffer already fits a maxSize x
+//                    maxSize board in any format
+//
+//  int render( const matrix<char> & board, char empty );
+//  int render( const nkBoard<N,K> & pos );
+//     postcondition: text() holds the board in format(), ending in a
+//                    newline; returns length().  Cells equal to empty
+//                    (' ' for nkBoard) are open.  RENDER_FEN lists the
+//                    rows top to bottom separated by '/', a run of open
+//                    cells as its length, then the side to move.
+//
+//  void write( ostream & out ) const;
+//     postcondition: the last board has been written with one call to
+//                    out.write; nothing is flushed
+//
+//  static bool parseFormat( const string & name, renderFormat & format );
+//     postcondition: sets format and returns true for "compact", "ansi"
+//                    or "fen"; returns false for anything else
+//
+//  Examples of use:
+//
+//     ios::sync_with_stdio(false);          // cout buffers on its own
+//     boardRenderer out(RENDER_FEN);
+//     for(int k = 0; k < games; k++)
+//     {
+//         out.render(positions[k]);
+//         out.write(cout);
+//     }
+
+inline boardRenderer::boardRenderer(renderFormat format, int maxSize)
+    : myLength(0),
+      myFormat(format)
+{
+    // the widest format is ANSI: a colour sequence around every mark
+    reserve(maxSize * (maxSize * 16 + 3) + 16);
+}
+
+inline int boardRenderer::render(const matrix<char> & board, char empty)
+{
+    return renderCells(board.numRows(), board.numCols(), empty,
+                       [&board](int r, int c) { return board[r][c]; });
+}
+
+template <int N, int K>
+int boardRenderer::render(const nkBoard<N, K> & pos)
+{
+    return renderCells(N, N, ' ',
+                       [&pos](int r, int c) { return pos.at(nkBoard<N, K>::cellOf(r, c), ' '); });
+}
+
+inline void boardRenderer::write(ostream & out) const
+{
+    out.write(text(), myLength);
+}
+
+inline const char * boardRenderer::text() const
+{
+    return myBuffer.size() > 0 ? &myBuffer[0] : "";
+}
+
+inline int boardRenderer::length() const
+{
+    return myLength;
+}
+
+inline renderFormat boardRenderer::format() const
+{
+    return myFormat;
+}
+
+inline void boardRenderer::setFormat(renderFormat format)
+{
+    myFormat = format;
+}
+
+inline bool boardRenderer::parseFormat(const string & name, renderFormat & format)
+{
+    if(name == "compact")
+    {
+        format = RENDER_COMPACT;
+    }
+    else if(name == "ansi")
+    {
+        format = RENDER_ANSI;
+    }
+    else if(name == "fen")
+    {
+        format = RENDER_FEN;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+template <class cellFunc>
+int boardRenderer::renderCells(int rows, int cols, char empty, cellFunc cellAt)
+// postcondition: the buffer holds the board in myFormat
+{
+    myLength = 0;
+    reserve(rows * (cols * 16 + 3) + 16);
+    int xs = 0, os = 0;
+
+    for(int r = 0; r < rows; r++)
+    {
+        if(myFormat == RENDER_FEN)
+        {
+            if(r > 0)
+            {
+                put('/');
+            }
+            int open = 0;
+            for(int c = 0; c < cols; c++)
+            {
+                char mark = cellAt(r, c);
+                if(mark == empty)
+                {
+                    open++;
+                    continue;
+                }
+                if(open > 0)
+                {
+                    putCount(open);
+                    open = 0;
+                }
+                xs += mark == 'x';
+                os += mark == 'o';
+                put(mark);
+            }
+            if(open > 0)
+            {
+                putCount(open);
+            }
+            continue;
+        }
+
+        put('|');
+        for(int c = 0; c < cols; c++)
+        {
+            char mark = cellAt(r, c);
+            if(myFormat == RENDER_ANSI && (mark == 'x' || mark == 'o'))
+            {
+                put(mark == 'x' ? "\033[1;31m" : "\033[1;34m");
+                put(mark);
+                put("\033[0m");
+            }
+            else
+            {
+                put(mark);
+            }
+            put('|');
+        }
+        put('\n');
+    }
+
+    if(myFormat == RENDER_FEN)
+    {
+        put(' ');
+        put(xs > os ? 'o' : 'x');            // x always moves first
+        put('\n');
+    }
+    return myLength;
+}
+
+inline void boardRenderer::put(char c)
+{
+    myBuffer[myLength++] = c;
+}
+
+inline void boardRenderer::put(const char * s)
+{
+    while(*s)
+    {
+        myBuffer[myLength++] = *s++;
+    }
+}
+
+inline void boardRenderer::putCount(int n)
+// precondition: n >= 1
+// postcondition: n is appended in decimal, any number of digits
+{
+    char digits[12];
+    int k = 0;
+    for(; n > 0; n /= 10)
+    {
+        digits[k++] = (char) ('0' + n % 10);
+    }
+    while(k > 0)
+    {
+        put(digits[--k]);
+    }
+}
+
+inline void boardRenderer::reserve(int chars)
+// postcondition: the buffer holds at least chars chars
+{
+    if(myBuffer.size() < chars)
+    {
+        myBuffer.resize(chars);
+    }
+}
+
+#endif
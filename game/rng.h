@@ -0,0 +1,91 @@
+#ifndef _RNG_H
+#define _RNG_H
+
+#include <stdint.h>
+using namespace std;
+
+
+// small, fast random number generator (xoshiro256**), one per thread so
+// that playouts and self-play never share state
+class fastRng
+{
+  public:
+
+  // constructor
+    explicit fastRng( uint64_t seed );
+
+  // random numbers
+    uint64_t next( );                        // 64 random bits
+    int below( int n );                      // uniform in 0..n-1
+    double unit( );                          // uniform in [0,1)
+
+  // modifiers
+    void reseed( uint64_t seed );
+
+  private:
+
+    uint64_t myState[4];
+};
+
+
+// *******************************************************************
+// Specifications for fastRng functions
+//
+//  explicit fastRng( uint64_t seed );
+//  void reseed( uint64_t seed );
+//     postcondition: the state is expanded from seed with splitmix64, so
+//                    the same seed always gives the same stream
+//
+//  int below( int n );
+//     precondition: n > 0
+//     postcondition: returns a value in 0..n-1 (multiply-shift, no
+//                    division)
+//
+//  Examples of use:
+//
+//     fastRng rng(42);
+//     int cell = cells[rng.below(numCells)];
+
+inline fastRng::fastRng(uint64_t seed)
+{
+    reseed(seed);
+}
+
+inline void fastRng::reseed(uint64_t seed)
+{
+    for(int k = 0; k < 4; k++)
+    {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        myState[k] = z ^ (z >> 31);
+    }
+}
+
+inline uint64_t fastRng::next()
+{
+    uint64_t * s = myState;
+    uint64_t result = s[1] * 5;
+    result = ((result << 7) | (result >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+inline int fastRng::below(int n)
+// precondition: n > 0
+{
+    return (int) (((next() >> 32) * (uint64_t) n) >> 32);
+}
+
+inline double fastRng::unit()
+{
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef _RULES_H
+#define _RULES_H
+
+#include "masks.h"
+using namespace std;
+
+
+// line tables for an N x N board where K marks in a row win.
+// Everything here is generated at compile time, so the common sizes
+// (3 x 3, 4 x 4, 5 x 5 with 4 in a row, 15 x 15 gomoku) pay nothing
+// at startup.
+template <int N, int K>
+struct lineTables
+{
+    static constexpr int CELLS = N * N;
+    static constexpr int LINES = 2 * N * (N - K + 1) + 2 * (N - K + 1) * (N - K + 1);
+    static constexpr int MAX_THROUGH = 4 * K;       // lines one cell can be on
+
+    typedef typename maskFor<CELLS>::type mask;
+
+    mask  line[LINES];                       // cells of each winning line
+    short through[CELLS][MAX_THROUGH];       // lines through each cell
+    short numThrough[CELLS];                 // used entries of through[cell]
+    mask  full;                              // every cell of the board
+
+    constexpr lineTables( ) : line{ }, through{ }, numThrough{ }, full{ } { }
+};
+
+template <int N, int K>
+constexpr lineTables<N, K> buildLineTables( );
+
+template <int N, int K>
+struct nkRules
+{
+    static_assert(1 <= K && K <= N, "need 1 <= K <= N");
+
+    static constexpr int SIZE = N;           // rows == cols
+    static constexpr int RUN = K;            // marks in a row to win
+    static constexpr int CELLS = N * N;
+    static constexpr int LINES = lineTables<N, K>::LINES;
+
+    typedef typename lineTables<N, K>::mask mask;
+    typedef maskOps<mask> ops;
+
+    static constexpr lineTables<N, K> TABLE = buildLineTables<N, K>();
+
+    static bool winsThrough( const mask & marks, int cell );
+    static bool hasWin( const mask & marks );
+};
+
+
+// *******************************************************************
+// Specifications for rules functions
+//
+//  constexpr lineTables<N,K> buildLineTables( );
+//     postcondition: line[] holds every run of K cells along rows,
+//                    columns, diagonals and anti-diagonals (in that
+//                    order); through[c][0..numThrough[c]-1] are the
+//                    indexes into line[] of the runs containing c
+//
+//  static bool winsThrough( const mask & marks, int cell );
+//     precondition: 0 <= cell < N*N
+//     postcondition: returns true if marks covers one of the lines
+//                    through cell (at most 4K mask tests)
+//
+//  static bool hasWin( const mask & marks );
+//     postcondition: returns true if marks covers any line
+//
+//  Examples of use:
+//
+//     typedef nkRules<15,5> gomoku;
+//     if(gomoku::winsThrough(pos.marks('x'), lastCell)) ...
+
+template <int N, int K>
+constexpr lineTables<N, K> buildLineTables()
+{
+    typedef typename lineTables<N, K>::mask mask;
+    typedef maskOps<mask> ops;
+
+    lineTables<N, K> t;
+    const int dr[4] = { 0, 1, 1, 1 };
+    const int dc[4] = { 1, 0, 1, -1 };
+    int n = 0;
+
+    for(int d = 0; d < 4; d++)
+    {
+        for(int r = 0; r < N; r++)
+        {
+            for(int c = 0; c < N; c++)
+            {
+                int endR = r + dr[d] * (K - 1);
+                int endC = c + dc[d] * (K - 1);
+                if(endR < 0 || endR >= N || endC < 0 || endC >= N)
+                {
+                    continue;                // run falls off the board
+                }
+                mask m{ };
+                for(int k = 0; k < K; k++)
+                {
+                    int cell = (r + dr[d] * k) * N + (c + dc[d] * k);
+                    m = m | ops::bit(cell);
+                    t.through[cell][t.numThrough[cell]++] = (short) n;
+                }
+                t.line[n++] = m;
+            }
+        }
+    }
+    t.full = ops::low(N * N);
+    return t;
+}
+
+template <int N, int K>
+bool nkRules<N, K>::winsThrough(const mask & marks, int cell)
+// postcondition: returns true if marks covers a line through cell
+{
+    const short * lines = TABLE.through[cell];
+    int count = TABLE.numThrough[cell];
+    for(int k = 0; k < count; k++)
+    {
+        const mask & line = TABLE.line[lines[k]];
+        if((marks & line) == line)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <int N, int K>
+bool nkRules<N, K>::hasWin(const mask & marks)
+// postcondition: returns true if marks covers any line
+{
+    for(int k = 0; k < LINES; k++)
+    {
+        if((marks & TABLE.line[k]) == TABLE.line[k])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
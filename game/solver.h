@@ -0,0 +1,332 @@
+#ifndef _SOLVER_H
+#define _SOLVER_H
+
+#include "winlines.h"
+#include "zobrist.h"
+#include "symmetry.h"
+#include "ttable.h"
+using namespace std;
+
+
+// perfect-play solver for nkBoard<N,K>: negamax with alpha-beta pruning
+// and a transposition table keyed by incrementally updated Zobrist
+// hashes.  The table is keyed by the canonical (symmetry-reduced) hash,
+// so the 8 rotations and reflections of a position share one entry and
+// its move is stored in canonical orientation.  Scores are from the
+// side to move: 0 is a draw, a win that ends the game with n marks on
+// the board scores N*N + 1 - n (faster wins score higher) and a loss is
+// the negative of the opponent's win.
+template <int N, int K>
+class solver
+{
+  public:
+
+    typedef nkBoard<N, K> board;
+    typedef typename board::mask mask;
+    typedef typename board::ops ops;
+
+    static constexpr int CELLS = N * N;
+    static constexpr int INF = CELLS + 2;    // beyond any score
+
+  // constructor
+    explicit solver( int ttBits );           // table of 2^ttBits entries
+
+  // solving
+    int value( const board & pos );          // exact value for side to move
+    int bestMove( const board & pos );       // a move that keeps the value
+    int bestMove( const board & pos, int & score );
+
+  // accessors
+    long long nodes( ) const;                // positions searched so far
+    static uint64_t hashOf( const board & pos );
+    static int winScore( int marks );        // score of a win at marks
+
+  // modifiers
+    void clear( );                           // forget all solved positions
+
+  private:
+
+    int negamax( board & pos, char p, symHash<N> & keys,
+                 int alpha, int beta, int * bestOut );
+    mask winningCells( const board & pos, char p ) const;
+
+    transTable myTable;                      // solved positions
+    long long myNodes;                       // nodes searched
+    int myOrder[CELLS];                      // cells, most lines first
+};
+
+
+// *******************************************************************
+// Specifications for solver functions
+//
+//  explicit solver( int ttBits );
+//     precondition: 0 <= ttBits < 31
+//     postcondition: solver with an empty table of 2^ttBits entries
+//
+//  int value( const board & pos );
+//     precondition: resultOf(pos) == ONGOING
+//     postcondition: returns the game-theoretic value for the side to
+//                    move (pos.toMove()); > 0 win, 0 draw, < 0 loss
+//
+//  int bestMove( const board & pos );
+//  int bestMove( const board & pos, int & score );
+//     precondition: resultOf(pos) == ONGOING
+//     postcondition: returns a cell that achieves value(pos) (and sets
+//                    score to it); among equal wins the fastest is chosen
+//
+//  static uint64_t hashOf( const board & pos );
+//     postcondition: returns the plain Zobrist hash of pos; search keeps
+//                    all 8 orientations' hashes (symHash) up to date with
+//                    one XOR each per move
+//
+//  static int winScore( int marks );
+//     postcondition: returns the score of a win that leaves marks marks
+//                    on the board
+//
+//  Search notes: before recursing, a node wins at once if it has a
+//  winning cell, loses if the opponent has two, and must block if the
+//  opponent has one.  Remaining moves are tried transposition-table
+//  move first, then cells on the most lines first.
+//
+//  Examples of use:
+//
+//     solver<3,3> s(16);
+//     int cell = s.bestMove(pos);           // perfect play for pos.toMove()
+
+template <int N, int K>
+solver<N, K>::solver(int ttBits)
+    : myTable(ttBits),
+      myNodes(0)
+{
+    const int center2 = N - 1;               // twice the center coordinate
+    int k, j;
+    for(k = 0; k < CELLS; k++)
+    {
+        myOrder[k] = k;
+    }
+    // insertion sort: more lines first, then closer to the center
+    for(k = 1; k < CELLS; k++)
+    {
+        int c = myOrder[k];
+        int lines = board::rules::TABLE.numThrough[c];
+        int dist = abs(2 * board::rowOf(c) - center2) + abs(2 * board::colOf(c) - center2);
+        for(j = k; j > 0; j--)
+        {
+            int o = myOrder[j - 1];
+            int oLines = board::rules::TABLE.numThrough[o];
+            int oDist = abs(2 * board::rowOf(o) - center2) + abs(2 * board::colOf(o) - center2);
+            if(oLines > lines || (oLines == lines && oDist <= dist))
+            {
+                break;
+            }
+            myOrder[j] = o;
+        }
+        myOrder[j] = c;
+    }
+}
+
+template <int N, int K>
+int solver<N, K>::value(const board & pos)
+// precondition: resultOf(pos) == ONGOING
+// postcondition: returns the value for the side to move
+{
+    board work = pos;
+    symHash<N> keys = symHashOf(pos);
+    return negamax(work, pos.toMove(), keys, -INF, INF, 0);
+}
+
+template <int N, int K>
+int solver<N, K>::bestMove(const board & pos)
+// precondition: resultOf(pos) == ONGOING
+// postcondition: returns a cell that achieves value(pos)
+{
+    int score;
+    return bestMove(pos, score);
+}
+
+template <int N, int K>
+int solver<N, K>::bestMove(const board & pos, int & score)
+// precondition: resultOf(pos) == ONGOING
+// postcondition: returns a cell that achieves value(pos), score is it
+{
+    board work = pos;
+    int move = -1;
+    symHash<N> keys = symHashOf(pos);
+    score = negamax(work, pos.toMove(), keys, -INF, INF, &move);
+    return move;
+}
+
+template <int N, int K>
+long long solver<N, K>::nodes() const
+{
+    return myNodes;
+}
+
+template <int N, int K>
+uint64_t solver<N, K>::hashOf(const board & pos)
+// postcondition: returns the Zobrist hash of pos
+{
+    uint64_t key = 0;
+    int cell;
+    for(cell = 0; cell < CELLS; cell++)
+    {
+        char c = pos.at(cell, ' ');
+        if(c != ' ')
+        {
+            key ^= zobrist<CELLS>::KEYS.cell(c, cell);
+        }
+    }
+    return key;
+}
+
+template <int N, int K>
+int solver<N, K>::winScore(int marks)
+{
+    return CELLS + 1 - marks;
+}
+
+template <int N, int K>
+void solver<N, K>::clear()
+{
+    myTable.clear();
+    myNodes = 0;
+}
+
+template <int N, int K>
+typename solver<N, K>::mask solver<N, K>::winningCells(const board & pos, char p) const
+// postcondition: returns the open cells where p would complete a line
+{
+    mask wins{ };
+    mask marks = pos.marks(p);
+    mask open = pos.legalMoves();
+    for(mask m = open; ops::any(m); ops::clearFirst(m))
+    {
+        int c = ops::first(m);
+        if(board::rules::winsThrough((mask) (marks | ops::bit(c)), c))
+        {
+            wins |= ops::bit(c);
+        }
+    }
+    return wins;
+}
+
+template <int N, int K>
+int solver<N, K>::negamax(board & pos, char p, symHash<N> & keys,
+                          int alpha, int beta, int * bestOut)
+// precondition: the game is not over, p is to move, keys == symHashOf(pos)
+// postcondition: returns the value of pos for p if it lies in
+//                (alpha,beta), otherwise a bound on the far side
+{
+    myNodes++;
+    char q = (p == 'x') ? 'o' : 'x';
+    int marks = pos.numMoves();
+    mask moves = pos.legalMoves();
+
+    if(!ops::any(moves))
+    {
+        return 0;                            // full board: draw
+    }
+
+    // win now if we can
+    mask wins = winningCells(pos, p);
+    if(ops::any(wins))
+    {
+        if(bestOut)
+        {
+            *bestOut = ops::first(wins);
+        }
+        return winScore(marks + 1);
+    }
+
+    // the opponent's threats: two can't both be blocked, one must be
+    mask threats = winningCells(pos, q);
+    int numThreats = ops::count(threats);
+    if(numThreats >= 2)
+    {
+        if(bestOut)
+        {
+            *bestOut = ops::first(threats);
+        }
+        return -winScore(marks + 2);
+    }
+    if(numThreats == 1)
+    {
+        moves = threats;
+    }
+
+    // transposition table; at the root only its move is used, so that
+    // the move returned is always backed by an exact score
+    int alphaOrig = alpha;
+    int ttMove = -1;
+    int orient;
+    uint64_t key = keys.canonical(orient);
+    const d4Maps<N> & maps = d4<N>::MAPS;
+    ttEntry e;
+    if(myTable.probe(key, e))
+    {
+        ttMove = maps.map[maps.inverse[orient]][e.move];
+    }
+    if(ttMove >= 0 && !bestOut)
+    {
+        if(e.bound == TT_EXACT ||
+           (e.bound == TT_LOWER && e.score >= beta) ||
+           (e.bound == TT_UPPER && e.score <= alpha))
+        {
+            return e.score;
+        }
+        if(e.bound == TT_LOWER && e.score > alpha)
+        {
+            alpha = e.score;
+        }
+        if(e.bound == TT_UPPER && e.score < beta)
+        {
+            beta = e.score;
+        }
+    }
+    if(ttMove >= 0 && !ops::test(moves, ttMove))
+    {
+        ttMove = -1;
+    }
+
+    int best = -INF;
+    int bestCell = -1;
+    int k;
+    for(k = -1; k < CELLS; k++)
+    {
+        int c = (k < 0) ? ttMove : myOrder[k];
+        if(c < 0 || !ops::test(moves, c) || (k >= 0 && c == ttMove))
+        {
+            continue;
+        }
+
+        pos.apply(c, p);
+        keys.toggle(p, c);
+        int score = -negamax(pos, q, keys, -beta, -alpha, 0);
+        keys.toggle(p, c);
+        pos.undo(c);
+
+        if(score > best)
+        {
+            best = score;
+            bestCell = c;
+            if(score > alpha)
+            {
+                alpha = score;
+                if(alpha >= beta)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    ttBound bound = best <= alphaOrig ? TT_UPPER : best >= beta ? TT_LOWER : TT_EXACT;
+    myTable.store(key, best, bound, maps.map[orient][bestCell]);
+    if(bestOut)
+    {
+        *bestOut = bestCell;
+    }
+    return best;
+}
+
+#endif
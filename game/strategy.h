@@ -0,0 +1,257 @@
+#ifndef _STRATEGY_H
+#define _STRATEGY_H
+
+#include <string>
+#include "solver.h"
+#include "mcts.h"
+#include "absearch.h"
+#include "rng.h"
+using namespace std;
+
+
+// a computer player: "choose a move for player p".  Strategies may keep
+// state between moves (the solver keeps its table), so each thread needs
+// its own instance; randomness comes from the caller's generator.
+template <int N, int K>
+class strategy
+{
+  public:
+
+    typedef nkBoard<N, K> board;
+
+    virtual ~strategy( ) { }
+
+    virtual int chooseMove( const board & pos, char p, fastRng & rng ) = 0;
+    virtual const char * name( ) const = 0;
+};
+
+// uniformly random open cell
+template <int N, int K>
+class randomStrategy : public strategy<N, K>
+{
+  public:
+
+    typedef nkBoard<N, K> board;
+
+    int chooseMove( const board & pos, char p, fastRng & rng );
+    const char * name( ) const { return "random"; }
+};
+
+// win if possible, block if needed, otherwise the cell on the most
+// lines still open to p (ties broken at random)
+template <int N, int K>
+class heuristicStrategy : public strategy<N, K>
+{
+  public:
+
+    typedef nkBoard<N, K> board;
+
+    int chooseMove( const board & pos, char p, fastRng & rng );
+    const char * name( ) const { return "heuristic"; }
+};
+
+// perfect play from solver<N,K>
+template <int N, int K>
+class solverStrategy : public strategy<N, K>
+{
+  public:
+
+    typedef nkBoard<N, K> board;
+
+    explicit solverStrategy( int ttBits ) : myBrain(ttBits) { }
+
+    int chooseMove( const board & pos, char p, fastRng & rng );
+    const char * name( ) const { return "solver"; }
+
+  private:
+
+    solver<N, K> myBrain;
+};
+
+// Monte Carlo tree search from mcts<N,K>; reseeded from the caller's
+// generator before every move so games stay repeatable
+template <int N, int K>
+class mctsStrategy : public strategy<N, K>
+{
+  public:
+
+    typedef nkBoard<N, K> board;
+
+    explicit mctsStrategy( const mctsLimits & limits ) : myBrain(limits) { }
+
+    int chooseMove( const board & pos, char p, fastRng & rng );
+    const char * name( ) const { return "mcts"; }
+
+  private:
+
+    mcts<N, K> myBrain;
+};
+
+// depth-limited alpha-beta from abSearch<N,K>
+template <int N, int K>
+class abStrategy : public strategy<N, K>
+{
+  public:
+
+    typedef nkBoard<N, K> board;
+
+    explicit abStrategy( const searchLimits & limits ) : myBrain(limits) { }
+
+    int chooseMove( const board & pos, char p, fastRng & rng );
+    const char * name( ) const { return "ab"; }
+
+  private:
+
+    abSearch<N, K> myBrain;
+};
+
+template <int N, int K>
+strategy<N, K> * makeStrategy( const string & name );
+
+template <int N, int K>
+int randomCell( const typename nkBoard<N, K>::mask & cells, fastRng & rng );
+
+
+// *******************************************************************
+// Specifications for strategy functions
+//
+//  virtual int chooseMove( const board & pos, char p, fastRng & rng );
+//     precondition: resultOf(pos) == ONGOING, p is to move
+//     postcondition: returns an open cell of pos
+//
+//  strategy<N,K> * makeStrategy( const string & name );
+//     postcondition: returns a new "random", "heuristic", "solver",
+//                    "mcts" or "ab" strategy (the caller deletes it), or
+//                    0 for an unknown name, or for "solver" on boards
+//                    bigger than 4 x 4, which it can't solve in any
+//                    useful time.  mcts runs 2000 single-threaded
+//                    playouts per move and ab searches 4 moves deep on one
+//                    thread, since callers already run one strategy per
+//                    thread
+//
+//  int randomCell( const mask & cells, fastRng & rng );
+//     precondition: cells has a set bit
+//     postcondition: returns one of the set cells, uniformly
+
+template <int N, int K>
+int randomCell(const typename nkBoard<N, K>::mask & cells, fastRng & rng)
+// precondition: cells has a set bit
+{
+    typedef typename nkBoard<N, K>::ops ops;
+    typename nkBoard<N, K>::mask m = cells;
+    int pick = rng.below(ops::count(m));
+    while(pick-- > 0)
+    {
+        ops::clearFirst(m);
+    }
+    return ops::first(m);
+}
+
+template <int N, int K>
+int randomStrategy<N, K>::chooseMove(const board & pos, char, fastRng & rng)
+{
+    return randomCell<N, K>(pos.legalMoves(), rng);
+}
+
+template <int N, int K>
+int heuristicStrategy<N, K>::chooseMove(const board & pos, char p, fastRng & rng)
+{
+    typedef typename board::mask mask;
+    typedef typename board::ops ops;
+    typedef typename board::rules rules;
+
+    char q = (p == 'x') ? 'o' : 'x';
+    mask open = pos.legalMoves();
+    mask block{ };
+    mask best{ };
+    int bestScore = -1;
+
+    for(mask m = open; ops::any(m); ops::clearFirst(m))
+    {
+        int c = ops::first(m);
+        if(rules::winsThrough((mask) (pos.marks(p) | ops::bit(c)), c))
+        {
+            return c;                        // win now
+        }
+        if(rules::winsThrough((mask) (pos.marks(q) | ops::bit(c)), c))
+        {
+            block |= ops::bit(c);
+        }
+
+        // lines through c that q has not touched, weighted by p's marks
+        int score = 0;
+        for(int k = 0; k < rules::TABLE.numThrough[c]; k++)
+        {
+            const mask & line = rules::TABLE.line[rules::TABLE.through[c][k]];
+            if(!ops::any((mask) (line & pos.marks(q))))
+            {
+                score += 1 + ops::count((mask) (line & pos.marks(p)));
+            }
+        }
+        if(score > bestScore)
+        {
+            bestScore = score;
+            best = ops::bit(c);
+        }
+        else if(score == bestScore)
+        {
+            best |= ops::bit(c);
+        }
+    }
+    return randomCell<N, K>(ops::any(block) ? block : best, rng);
+}
+
+template <int N, int K>
+int solverStrategy<N, K>::chooseMove(const board & pos, char, fastRng &)
+{
+    return myBrain.bestMove(pos);
+}
+
+template <int N, int K>
+int mctsStrategy<N, K>::chooseMove(const board & pos, char, fastRng & rng)
+{
+    myBrain.reseed(rng.next());
+    return myBrain.bestMove(pos);
+}
+
+template <int N, int K>
+int abStrategy<N, K>::chooseMove(const board & pos, char, fastRng &)
+{
+    return myBrain.bestMove(pos);
+}
+
+template <int N, int K>
+strategy<N, K> * makeStrategy(const string & name)
+// postcondition: returns a new strategy called name, or 0
+{
+    if(name == "random")
+    {
+        return new randomStrategy<N, K>;
+    }
+    if(name == "heuristic")
+    {
+        return new heuristicStrategy<N, K>;
+    }
+    if(name == "solver" && N <= 4)           // bigger boards never finish
+    {
+        return new solverStrategy<N, K>(N * N <= 9 ? 14 : 22);
+    }
+    if(name == "mcts")
+    {
+        mctsLimits limits;
+        limits.iterations = 2000;
+        limits.nodes = 1 << 16;
+        return new mctsStrategy<N, K>(limits);
+    }
+    if(name == "ab")
+    {
+        searchLimits limits;
+        limits.milliseconds = 0;
+        limits.depth = 4;
+        limits.ttBits = 16;
+        return new abStrategy<N, K>(limits);
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef _SYMMETRY_H
+#define _SYMMETRY_H
+
+#include "bitboard.h"
+#include "zobrist.h"
+using namespace std;
+
+
+// the 8 symmetries of a square board (the dihedral group D4):
+// transform t < 4 rotates a quarter turn clockwise t times, t >= 4
+// mirrors left-right first and then rotates t - 4 times.
+// map[t][cell] is where cell goes under t; inverse[t] undoes t.
+template <int N>
+struct d4Maps
+{
+    short map[8][N * N];
+    int   inverse[8];
+
+    constexpr d4Maps( );
+};
+
+template <int N>
+struct d4
+{
+    static constexpr d4Maps<N> MAPS = d4Maps<N>();
+};
+
+// 3 x 3 fast path: every 9-bit mask under every transform, precomputed
+struct d4Lut3
+{
+    uint16_t image[8][512];
+
+    constexpr d4Lut3( );
+};
+
+// a board in canonical orientation plus the transform that produced it
+template <int N, int K>
+struct canonicalForm
+{
+    nkBoard<N, K> board;                     // canonical representative
+    int transform;                           // original -> canonical
+
+    int toCanonical( int cell ) const;       // original cell -> canonical
+    int toOriginal( int cell ) const;        // canonical cell -> original
+};
+
+// the 8 Zobrist hashes of a position, one per orientation, kept up to
+// date with one XOR each per move; the smallest one is a hash of the
+// canonical position, so all 8 symmetric boards share a table slot
+template <int N>
+struct symHash
+{
+    uint64_t h[8];
+
+    symHash( );
+
+    void toggle( char p, int cell );         // p marks or unmarks cell
+    uint64_t canonical( int & transform ) const;
+};
+
+template <int N, int K>
+nkBoard<N, K> transformBoard( const nkBoard<N, K> & pos, int t );
+
+template <int N, int K>
+canonicalForm<N, K> canonicalize( const nkBoard<N, K> & pos );
+
+template <int N, int K>
+canonicalForm<N, K> canonicalize( const matrix<char> & board );
+
+template <int N, int K>
+symHash<N> symHashOf( const nkBoard<N, K> & pos );
+
+
+// *******************************************************************
+// Specifications for symmetry functions
+//
+//  nkBoard<N,K> transformBoard( const nkBoard<N,K> & pos, int t );
+//     precondition: 0 <= t < 8
+//     postcondition: returns pos with every mark moved by transform t
+//                    (3 x 3 uses two table lookups, larger boards move
+//                    one bit per mark)
+//
+//  canonicalForm<N,K> canonicalize( const nkBoard<N,K> & pos );
+//  canonicalForm<N,K> canonicalize( const matrix<char> & board );
+//     postcondition: returns the image of the position with the smallest
+//                    (x marks, o marks) over all 8 transforms, and the
+//                    transform used; symmetric positions give the same
+//                    board
+//
+//  int canonicalForm::toCanonical( int cell ) const;
+//  int canonicalForm::toOriginal( int cell ) const;
+//     postcondition: moves a cell between the original and canonical
+//                    orientations (a best move stored for the canonical
+//                    board is played as toOriginal(move))
+//
+//  void symHash::toggle( char p, int cell );
+//     postcondition: all 8 hashes account for p marking (or, done twice,
+//                    unmarking) cell
+//
+//  uint64_t symHash::canonical( int & transform ) const;
+//     postcondition: returns the smallest of the 8 hashes and sets
+//                    transform to the orientation it belongs to
+//
+//  Examples of use:
+//
+//     canonicalForm<3,3> cf = canonicalize(pos);
+//     int move = cf.toOriginal(bestMoveFor(cf.board));
+
+template <int N>
+constexpr d4Maps<N>::d4Maps()
+    : map{ }, inverse{ }
+{
+    for(int t = 0; t < 8; t++)
+    {
+        for(int cell = 0; cell < N * N; cell++)
+        {
+            int r = cell / N;
+            int c = cell % N;
+            if(t >= 4)
+            {
+                c = N - 1 - c;               // mirror
+            }
+            for(int k = 0; k < t % 4; k++)
+            {
+                int oldR = r;                // quarter turn clockwise
+                r = c;
+                c = N - 1 - oldR;
+            }
+            map[t][cell] = (short) (r * N + c);
+        }
+    }
+    for(int t = 0; t < 8; t++)
+    {
+        for(int u = 0; u < 8; u++)
+        {
+            bool undoes = true;
+            for(int cell = 0; cell < N * N; cell++)
+            {
+                if(map[u][map[t][cell]] != cell)
+                {
+                    undoes = false;
+                }
+            }
+            if(undoes)
+            {
+                inverse[t] = u;
+            }
+        }
+    }
+}
+
+constexpr d4Lut3::d4Lut3()
+    : image{ }
+{
+    d4Maps<3> maps;
+    for(int t = 0; t < 8; t++)
+    {
+        for(int m = 0; m < 512; m++)
+        {
+            int out = 0;
+            for(int cell = 0; cell < 9; cell++)
+            {
+                if(m & (1 << cell))
+                {
+                    out |= 1 << maps.map[t][cell];
+                }
+            }
+            image[t][m] = (uint16_t) out;
+        }
+    }
+}
+
+inline constexpr d4Lut3 D4_LUT3 = d4Lut3();
+
+template <int N, int K>
+int canonicalForm<N, K>::toCanonical(int cell) const
+{
+    return d4<N>::MAPS.map[transform][cell];
+}
+
+template <int N, int K>
+int canonicalForm<N, K>::toOriginal(int cell) const
+{
+    return d4<N>::MAPS.map[d4<N>::MAPS.inverse[transform]][cell];
+}
+
+template <int N, int K>
+nkBoard<N, K> transformBoard(const nkBoard<N, K> & pos, int t)
+// precondition: 0 <= t < 8
+// postcondition: returns pos moved by transform t
+{
+    typedef typename nkBoard<N, K>::mask mask;
+    typedef typename nkBoard<N, K>::ops ops;
+
+    if constexpr (N == 3)
+    {
+        return nkBoard<N, K>(D4_LUT3.image[t][pos.marks('x')],
+                             D4_LUT3.image[t][pos.marks('o')]);
+    }
+    else
+    {
+        const short * to = d4<N>::MAPS.map[t];
+        mask xs{ }, os{ };
+        for(mask m = pos.marks('x'); ops::any(m); ops::clearFirst(m))
+        {
+            xs |= ops::bit(to[ops::first(m)]);
+        }
+        for(mask m = pos.marks('o'); ops::any(m); ops::clearFirst(m))
+        {
+            os |= ops::bit(to[ops::first(m)]);
+        }
+        return nkBoard<N, K>(xs, os);
+    }
+}
+
+template <int N, int K>
+canonicalForm<N, K> canonicalize(const nkBoard<N, K> & pos)
+// postcondition: returns the canonical representative of pos
+{
+    typedef typename nkBoard<N, K>::ops ops;
+
+    canonicalForm<N, K> best;
+    best.board = pos;
+    best.transform = 0;
+    for(int t = 1; t < 8; t++)
+    {
+        nkBoard<N, K> img = transformBoard(pos, t);
+        const typename nkBoard<N, K>::mask & ix = img.marks('x');
+        const typename nkBoard<N, K>::mask & bx = best.board.marks('x');
+        if(ops::less(ix, bx) ||
+           (ix == bx && ops::less(img.marks('o'), best.board.marks('o'))))
+        {
+            best.board = img;
+            best.transform = t;
+        }
+    }
+    return best;
+}
+
+template <int N, int K>
+canonicalForm<N, K> canonicalize(const matrix<char> & board)
+// precondition: board is N x N
+// postcondition: returns the canonical representative of board
+{
+    return canonicalize(nkBoard<N, K>::fromMatrix(board));
+}
+
+template <int N>
+symHash<N>::symHash()
+{
+    for(int t = 0; t < 8; t++)
+    {
+        h[t] = 0;
+    }
+}
+
+template <int N>
+void symHash<N>::toggle(char p, int cell)
+// postcondition: all 8 hashes account for p at cell
+{
+    for(int t = 0; t < 8; t++)
+    {
+        h[t] ^= zobrist<N * N>::KEYS.cell(p, d4<N>::MAPS.map[t][cell]);
+    }
+}
+
+template <int N>
+uint64_t symHash<N>::canonical(int & transform) const
+// postcondition: returns the smallest hash, transform is its orientation
+{
+    transform = 0;
+    for(int t = 1; t < 8; t++)
+    {
+        if(h[t] < h[transform])
+        {
+            transform = t;
+        }
+    }
+    return h[transform];
+}
+
+template <int N, int K>
+symHash<N> symHashOf(const nkBoard<N, K> & pos)
+// postcondition: returns the 8 hashes of pos
+{
+    symHash<N> sh;
+    for(int cell = 0; cell < N * N; cell++)
+    {
+        char c = pos.at(cell, ' ');
+        if(c != ' ')
+        {
+            sh.toggle(c, cell);
+        }
+    }
+    return sh;
+}
+
+#endif
@@ -0,0 +1,377 @@
+#ifndef _THREATS_H
+#define _THREATS_H
+
+#include <stdint.h>
+#include "gamestate.h"
+using namespace std;
+
+
+// threat-space bookkeeping for the searches on big boards.  Alongside a
+// gameState it keeps, per player, how many lines hold 1, 2, ... K of
+// that player's marks and none of the other's (open lines; a line with
+// both players on it is dead and counted for neither), and for every
+// cell how many marks lie within RADIUS of it.  apply and undo update
+// both for the lines and cells around one move, so a position is scored
+// in O(K) and the cells worth trying are one mask AND, instead of a
+// scan of every line or every cell.
+//
+// Candidate moves are scored by the threats they make and stop: a move
+// onto an open line turns a line of n into n+1, a move onto a line only
+// the opponent holds kills it, and a move making threats (lines of at
+// least K-2, or 2 on small boards) in two directions at once is a fork.
+template <int N, int K>
+class threatState
+{
+  public:
+
+    typedef nkBoard<N, K> board;
+    typedef typename board::mask mask;
+    typedef typename board::ops ops;
+    typedef nkRules<N, K> rules;
+
+    static constexpr int CELLS = N * N;
+    static constexpr int LINES = rules::LINES;
+    static constexpr int RADIUS = 2;         // how near a candidate must be
+    static constexpr int WIDE = 7;           // bigger boards prune candidates
+
+  // constructors
+    threatState( );                          // empty board, 'x' to move
+    explicit threatState( const board & pos ); // pick up a game at pos
+
+  // accessors
+    const gameState<N, K> & game( ) const;   // board, hash, result, moves
+    int  openLines( char p, int marks ) const; // p's open lines with marks
+    mask winningCells( char p ) const;       // open cells completing a line
+    int  evaluate( ) const;                  // for the side to move
+    int  cellScore( int cell ) const;        // for the side to move
+    mask candidateCells( ) const;            // cells worth trying
+    int  candidates( uint8_t * cells ) const;  // the same, best first
+    int  order( const mask & cells, uint8_t * out ) const;
+
+  // modifiers
+    void apply( int cell );                  // toMove() marks cell
+    void undo( );                            // take back the latest move
+    void clear( );                           // back to the empty board
+
+    static int weight( int marks );          // value of an open line
+
+  private:
+
+    void tally( int cell, int sign );        // open-line counts through cell
+    void mark( int cell, int sign );         // near counts around cell
+    static int direction( int line );        // 0 rows, 1 cols, 2 and 3 diagonals
+
+    gameState<N, K> myGame;
+    int myOpen[2][K + 1];                    // [0] = 'x', [1] = 'o'
+    uint8_t myNearCount[CELLS];              // marks within RADIUS
+    mask myNear;                             // cells with myNearCount > 0
+};
+
+
+// *******************************************************************
+// Specifications for threatState functions
+//
+// apply and undo cost one gameState move plus the lines through the
+// cell (at most 4K) and the (2 RADIUS + 1)^2 cells around it.
+//
+//  int openLines( char p, int marks ) const;
+//     precondition: 1 <= marks <= K
+//     postcondition: returns how many lines hold exactly marks of p's
+//                    marks and none of the other player's
+//
+//  mask winningCells( char p ) const;
+//     postcondition: the open cells where p would complete a line; empty
+//                    straight away when p has no line of K-1
+//
+//  int evaluate( ) const;
+//     postcondition: the sum of weight(marks) over the side to move's
+//                    open lines, minus the same for the other player
+//
+//  int cellScore( int cell ) const;
+//     precondition: game().isOpen(cell)
+//     postcondition: for each line through cell, weight(n+1) if the side
+//                    to move holds it with n marks and weight(n+1) if the
+//                    other player does; plus weight(K-1) for each player
+//                    that would have (or lose) threats in two directions
+//
+//  mask candidateCells( ) const;
+//     postcondition: every open cell on boards up to WIDE x WIDE; on
+//                    bigger ones the open cells within RADIUS of a mark,
+//                    or the center of an empty board
+//
+//  int candidates( uint8_t * cells ) const;
+//  int order( const mask & cells, uint8_t * out ) const;
+//     precondition: the array has room for N*N cells
+//     postcondition: the cells (candidateCells() or cells) from highest
+//                    cellScore to lowest, equal scores in cell order;
+//                    returns how many
+//
+//  static int weight( int marks );
+//     postcondition: 4^marks, capped at 4^7
+//
+//  Examples of use:
+//
+//     threatState<15,5> game;
+//     uint8_t moves[225];
+//     game.apply(112);                       // x takes the center
+//     int n = game.candidates(moves);       // moves[0] is o's best try
+
+template <int N, int K>
+threatState<N, K>::threatState()
+// postcondition: empty board, 'x' to move
+{
+    clear();
+}
+
+template <int N, int K>
+threatState<N, K>::threatState(const board & pos)
+// precondition: pos is a legal ongoing position
+// postcondition: the state of pos with pos.toMove() to move
+{
+    clear();
+    gameState<N, K> replay(pos);
+    for(int k = 0; k < replay.numMoves(); k++)
+    {
+        apply(replay.move(k));
+    }
+}
+
+template <int N, int K>
+const gameState<N, K> & threatState<N, K>::game() const
+{
+    return myGame;
+}
+
+template <int N, int K>
+int threatState<N, K>::openLines(char p, int marks) const
+// precondition: 1 <= marks <= K
+{
+    return myOpen[p == 'x' ? 0 : 1][marks];
+}
+
+template <int N, int K>
+typename threatState<N, K>::mask threatState<N, K>::winningCells(char p) const
+// postcondition: the open cells where p would complete a line
+{
+    mask wins{ };
+    if(openLines(p, K - 1) == 0)
+    {
+        return wins;
+    }
+    mask open = myGame.position().legalMoves();
+    for(int line = 0; line < LINES; line++)
+    {
+        if(myGame.lineCount(p, line) == K - 1)
+        {
+            wins |= (mask) (rules::TABLE.line[line] & open);
+        }
+    }
+    return wins;
+}
+
+template <int N, int K>
+int threatState<N, K>::evaluate() const
+// postcondition: open-line score for the side to move
+{
+    int score = 0;
+    for(int marks = 1; marks <= K; marks++)
+    {
+        score += (myOpen[0][marks] - myOpen[1][marks]) * weight(marks);
+    }
+    return myGame.toMove() == 'x' ? score : -score;
+}
+
+template <int N, int K>
+int threatState<N, K>::cellScore(int cell) const
+// precondition: game().isOpen(cell)
+{
+    char p = myGame.toMove();
+    char q = (p == 'x') ? 'o' : 'x';
+    int threat = (K - 2 > 2) ? K - 2 : 2;
+    int score = 0;
+    int made = 0;                            // directions with a threat made
+    int stopped = 0;                         // ... and stopped
+    const short * lines = rules::TABLE.through[cell];
+    for(int k = 0; k < rules::TABLE.numThrough[cell]; k++)
+    {
+        int mine = myGame.lineCount(p, lines[k]);
+        int theirs = myGame.lineCount(q, lines[k]);
+        if(theirs == 0)
+        {
+            score += weight(mine + 1);
+            if(mine + 1 >= threat)
+            {
+                made |= 1 << direction(lines[k]);
+            }
+        }
+        if(mine == 0)
+        {
+            score += weight(theirs + 1);
+            if(theirs + 1 >= threat)
+            {
+                stopped |= 1 << direction(lines[k]);
+            }
+        }
+    }
+    if(made & (made - 1))                    // two directions or more
+    {
+        score += weight(K - 1);
+    }
+    if(stopped & (stopped - 1))
+    {
+        score += weight(K - 1);
+    }
+    return score;
+}
+
+template <int N, int K>
+typename threatState<N, K>::mask threatState<N, K>::candidateCells() const
+// postcondition: the open cells a search should try
+{
+    mask open = myGame.position().legalMoves();
+    if(N <= WIDE)
+    {
+        return open;
+    }
+    mask near = (mask) (myNear & open);
+    return ops::any(near) ? near : board::bit(board::cellOf(N / 2, N / 2));
+}
+
+template <int N, int K>
+int threatState<N, K>::candidates(uint8_t * cells) const
+// postcondition: candidateCells() best first; returns how many
+{
+    return order(candidateCells(), cells);
+}
+
+template <int N, int K>
+int threatState<N, K>::order(const mask & cells, uint8_t * out) const
+// postcondition: the cells best first; returns how many
+{
+    int scores[CELLS];
+    int n = 0;
+    for(mask m = cells; ops::any(m); ops::clearFirst(m))
+    {
+        int c = ops::first(m);
+        int s = cellScore(c);
+        int j;
+        for(j = n; j > 0 && scores[j - 1] < s; j--)
+        {
+            scores[j] = scores[j - 1];
+            out[j] = out[j - 1];
+        }
+        scores[j] = s;
+        out[j] = (uint8_t) c;
+        n++;
+    }
+    return n;
+}
+
+template <int N, int K>
+void threatState<N, K>::apply(int cell)
+// precondition: game().result() == ONGOING, game().isOpen(cell)
+// postcondition: as gameState::apply, with the counts updated
+{
+    tally(cell, -1);
+    myGame.apply(cell);
+    tally(cell, +1);
+    mark(cell, +1);
+}
+
+template <int N, int K>
+void threatState<N, K>::undo()
+// precondition: game().numMoves() > 0
+// postcondition: the state is exactly as before the latest apply
+{
+    int cell = myGame.lastMove();
+    mark(cell, -1);
+    tally(cell, -1);
+    myGame.undo();
+    tally(cell, +1);
+}
+
+template <int N, int K>
+void threatState<N, K>::clear()
+// postcondition: empty board, 'x' to move
+{
+    myGame.clear();
+    for(int marks = 0; marks <= K; marks++)
+    {
+        myOpen[0][marks] = myOpen[1][marks] = 0;
+    }
+    for(int c = 0; c < CELLS; c++)
+    {
+        myNearCount[c] = 0;
+    }
+    myNear = mask{ };
+}
+
+template <int N, int K>
+int threatState<N, K>::weight(int marks)
+{
+    return 1 << (2 * (marks < 7 ? marks : 7));
+}
+
+template <int N, int K>
+void threatState<N, K>::tally(int cell, int sign)
+// postcondition: the lines through cell are added to (sign +1) or taken
+//                out of (sign -1) myOpen
+{
+    const short * lines = rules::TABLE.through[cell];
+    for(int k = 0; k < rules::TABLE.numThrough[cell]; k++)
+    {
+        int xs = myGame.lineCount('x', lines[k]);
+        int os = myGame.lineCount('o', lines[k]);
+        if(os == 0 && xs > 0)
+        {
+            myOpen[0][xs] += sign;
+        }
+        else if(xs == 0 && os > 0)
+        {
+            myOpen[1][os] += sign;
+        }
+    }
+}
+
+template <int N, int K>
+void threatState<N, K>::mark(int cell, int sign)
+// postcondition: the cells within RADIUS of cell have one more (sign +1)
+//                or one fewer (sign -1) mark near them
+{
+    int row = board::rowOf(cell), col = board::colOf(cell);
+    for(int r = row - RADIUS; r <= row + RADIUS; r++)
+    {
+        for(int c = col - RADIUS; c <= col + RADIUS; c++)
+        {
+            if(r < 0 || r >= N || c < 0 || c >= N)
+            {
+                continue;
+            }
+            int near = board::cellOf(r, c);
+            myNearCount[near] += sign;
+            if(myNearCount[near] == (sign > 0 ? 1 : 0))
+            {
+                myNear = (mask) (myNear ^ board::bit(near));  // crossed zero
+            }
+        }
+    }
+}
+
+template <int N, int K>
+int threatState<N, K>::direction(int line)
+// postcondition: which way line runs, from its place in rules::TABLE
+{
+    const int rows = N * (N - K + 1);
+    const int diagonals = (N - K + 1) * (N - K + 1);
+    if(line < rows)
+    {
+        return 0;
+    }
+    if(line < 2 * rows)
+    {
+        return 1;
+    }
+    return line < 2 * rows + diagonals ? 2 : 3;
+}
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef _TTABLE_H
+#define _TTABLE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <iostream>
+#include <cstdlib>
+#include "../m/mlist.h"
+using namespace std;
+
+
+// how a stored score relates to the true value of the position
+enum ttBound
+{
+    TT_NONE,                                 // empty slot
+    TT_EXACT,                                // score is the value
+    TT_LOWER,                                // value >= score (fail high)
+    TT_UPPER                                 // value <= score (fail low)
+};
+
+struct ttEntry
+{
+    uint64_t key;                            // full hash, detects collisions
+    short    score;                          // from the side to move
+    unsigned char bound;                     // a ttBound
+    unsigned char move;                      // best or refuting cell
+
+    ttEntry( ) : key(0), score(0), bound(TT_NONE), move(0) { }
+};
+
+// hash-keyed transposition table: a power-of-two array of entries
+// indexed by the low bits of the Zobrist key, always-replace
+class transTable
+{
+  public:
+
+  // constructor
+    explicit transTable( int bits );         // 2^bits entries
+
+  // lookups
+    bool probe( uint64_t key, ttEntry & found ) const;
+    void store( uint64_t key, int score, ttBound bound, int move );
+    void clear( );
+
+  // accessors
+    int size( ) const;                       // number of slots
+
+  private:
+
+    mlist<ttEntry> myTable;                  // the slots
+    uint64_t myMask;                         // size - 1
+};
+
+// transposition table shared by search threads without locks.  A slot
+// is two 64-bit words stored one after the other: the packed entry, and
+// the key XOR that entry.  A reader that meets a slot another thread is
+// halfway through writing gets a check that doesn't match its key and
+// treats it as a miss, so a torn entry is never used.
+class sharedTable
+{
+  public:
+
+  // constructor/destructor
+    explicit sharedTable( int bits );        // 2^bits entries
+    ~sharedTable( );
+
+  // lookups
+    bool probe( uint64_t key, ttEntry & found, int & depth ) const;
+    void store( uint64_t key, int score, ttBound bound, int move, int depth );
+    void clear( );
+
+  // accessors
+    int size( ) const;                       // number of slots
+
+  private:
+
+    struct slot
+    {
+        atomic<uint64_t> check;              // key ^ data
+        atomic<uint64_t> data;               // score, move, bound, depth
+    };
+
+    sharedTable( const sharedTable & );      // not copyable
+    void operator = ( const sharedTable & );
+
+    slot * mySlots;
+    uint64_t myMask;                         // size - 1
+};
+
+
+// *******************************************************************
+// Specifications for transTable functions
+//
+//  explicit transTable( int bits );
+//     precondition: 0 <= bits < 31
+//     postcondition: table has 2^bits empty slots
+//
+//  bool probe( uint64_t key, ttEntry & found ) const;
+//     postcondition: if the slot for key holds key, found is a copy of it
+//                    and true is returned; otherwise returns false
+//
+//  void store( uint64_t key, int score, ttBound bound, int move );
+//     postcondition: the slot for key holds (key, score, bound, move),
+//                    replacing whatever was there
+//
+//  void clear( );
+//     postcondition: every slot is empty
+//
+// sharedTable works the same way, and may be probed and stored from any
+// number of threads at once:
+//
+//  bool probe( uint64_t key, ttEntry & found, int & depth ) const;
+//     postcondition: if the slot for key holds a whole entry for key,
+//                    found and depth (how deep it was searched) are set
+//                    from it and true is returned
+//
+//  void store( uint64_t key, int score, ttBound bound, int move, int depth );
+//     precondition: -32768 <= score < 32768, 0 <= move < 256,
+//                   0 <= depth < 256
+//     postcondition: the slot for key holds the entry, unless it already
+//                    held a deeper search of the same key
+
+inline transTable::transTable(int bits)
+    : myTable(1 << bits),
+      myMask((uint64_t) (1 << bits) - 1)
+{
+
+}
+
+inline bool transTable::probe(uint64_t key, ttEntry & found) const
+// postcondition: found is the stored entry for key, if there is one
+{
+    const ttEntry & e = myTable[(int) (key & myMask)];
+    if(e.bound == TT_NONE || e.key != key)
+    {
+        return false;
+    }
+    found = e;
+    return true;
+}
+
+inline void transTable::store(uint64_t key, int score, ttBound bound, int move)
+// postcondition: the slot for key holds the new entry
+{
+    ttEntry & e = myTable[(int) (key & myMask)];
+    e.key = key;
+    e.score = (short) score;
+    e.bound = (unsigned char) bound;
+    e.move = (unsigned char) move;
+}
+
+inline void transTable::clear()
+// postcondition: every slot is empty
+{
+    int k;
+    for(k = 0; k < myTable.size(); k++)
+    {
+        myTable[k] = ttEntry();
+    }
+}
+
+inline int transTable::size() const
+{
+    return myTable.size();
+}
+
+inline sharedTable::sharedTable(int bits)
+    : mySlots(new slot[(size_t) 1 << bits]),
+      myMask((uint64_t) (1 << bits) - 1)
+{
+    clear();
+}
+
+inline sharedTable::~sharedTable()
+{
+    delete [] mySlots;
+}
+
+inline bool sharedTable::probe(uint64_t key, ttEntry & found, int & depth) const
+// postcondition: found is the stored entry for key, if there is a whole one
+{
+    const slot & s = mySlots[key & myMask];
+    uint64_t data = s.data.load(memory_order_relaxed);
+    uint64_t check = s.check.load(memory_order_relaxed);
+    if((check ^ data) != key || ((data >> 40) & 0xFF) == TT_NONE)
+    {
+        return false;                        // empty, another key, or torn
+    }
+    found.key = key;
+    found.score = (short) (data & 0xFFFF);
+    found.move = (unsigned char) ((data >> 32) & 0xFF);
+    found.bound = (unsigned char) ((data >> 40) & 0xFF);
+    depth = (int) ((data >> 48) & 0xFF);
+    return true;
+}
+
+inline void sharedTable::store(uint64_t key, int score, ttBound bound, int move, int depth)
+// postcondition: the slot for key holds the entry unless it held a deeper one
+{
+    slot & s = mySlots[key & myMask];
+    uint64_t old = s.data.load(memory_order_relaxed);
+    if((s.check.load(memory_order_relaxed) ^ old) == key && (int) ((old >> 48) & 0xFF) > depth)
+    {
+        return;
+    }
+    uint64_t data = (uint64_t) (uint16_t) score | (uint64_t) move << 32 |
+                    (uint64_t) bound << 40 | (uint64_t) depth << 48;
+    s.check.store(key ^ data, memory_order_relaxed);
+    s.data.store(data, memory_order_relaxed);
+}
+
+inline void sharedTable::clear()
+// postcondition: every slot is empty
+{
+    for(uint64_t k = 0; k <= myMask; k++)
+    {
+        mySlots[k].data.store(0, memory_order_relaxed);
+        mySlots[k].check.store(0, memory_order_relaxed);
+    }
+}
+
+inline int sharedTable::size() const
+{
+    return (int) (myMask + 1);
+}
+
+#endif
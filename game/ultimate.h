@@ -0,0 +1,278 @@
+#ifndef _ULTIMATE_H
+#define _ULTIMATE_H
+
+#include <stdint.h>
+#include "bitboard.h"
+#include "winlines.h"
+#include "../m/matrix.h"
+using namespace std;
+
+
+// Ultimate tic-tac-toe: a 3 x 3 grid of 3 x 3 boards.  The cell a move
+// takes inside its small board picks the small board the opponent must
+// play in next; if that board is already won or full, any open board
+// will do.  Winning three small boards in a line wins the game.
+//
+// Each small board is a bitboard.  Its result is cached and only
+// recomputed (with resultAfter, the single-board checkWin) when a move
+// lands on it, and the small boards' results are themselves kept as a
+// bitboard so the big board is checked with the same line tables.
+//
+// Moves are numbered row * 9 + col on the 9 x 9 grid.
+class ultimateBoard
+{
+  public:
+
+    static const int SIZE = 9;               // rows == cols of the grid
+    static const int CELLS = 81;
+    static const int ANY = -1;               // no small board is forced
+
+  // constructor
+    ultimateBoard( );                        // empty grid, 'x' to move
+
+  // accessors
+    char toMove( ) const;
+    int  forced( ) const;                    // small board to play in, or ANY
+    gameResult result( ) const;              // of the whole game
+    gameResult subResult( int sub ) const;   // of small board sub
+    const bitboard & sub( int sub ) const;
+    int  numMoves( ) const;
+    bool isLegal( int move ) const;
+    int  legalMoves( uint8_t * moves ) const;  // returns how many
+    void toMatrix( matrix<char> & grid, char empty ) const;
+
+  // modifiers
+    void apply( int move );
+    void undo( );                            // take back the latest move
+
+  // move helpers
+    static int moveOf( int row, int col );
+    static int subOf( int move );            // which small board
+    static int cellOf( int move );           // cell inside it
+
+  private:
+
+    bool isOpenSub( int sub ) const;         // still being played
+
+    bitboard mySubs[9];
+    gameResult mySubResult[9];               // cached, ONGOING until decided
+    bitboard myBig;                          // small boards won, as marks
+    bitboard::mask myClosed;                 // small boards won or full
+    gameResult myResult;
+    char mySide;
+    int myForced;
+    int myNumMoves;
+    uint8_t myMoves[CELLS];                  // the move stack
+    int8_t myForcedBefore[CELLS];            // forced() before each move
+};
+
+
+// *******************************************************************
+// Specifications for ultimateBoard functions
+//
+//  int forced( ) const;
+//     postcondition: the small board (0-8, row-major) the next move must
+//                    be in, or ANY when it may go in any open one
+//
+//  bool isLegal( int move ) const;
+//     postcondition: returns true if 0 <= move < 81, the game is ongoing,
+//                    the cell is open, and its small board is open and
+//                    allowed by forced()
+//
+//  int legalMoves( uint8_t * moves ) const;
+//     precondition: moves has room for 81 entries
+//     postcondition: moves holds every legal move, board by board;
+//                    returns how many (0 once the game is over).  Only
+//                    the open cells of allowed boards are visited, one
+//                    bit at a time.
+//
+//  void toMatrix( matrix<char> & grid, char empty ) const;
+//     postcondition: grid is 9 x 9 with 'x', 'o' or empty per cell
+//
+//  void apply( int move );
+//     precondition: isLegal(move)
+//     postcondition: toMove() has marked move; its small board's cached
+//                    result and, if that board was decided, the big
+//                    board's result are updated; the other player is to
+//                    move in the board picked by the move
+//
+//  void undo( );
+//     precondition: numMoves() > 0
+//     postcondition: everything is as before the latest apply
+//
+//  Examples of use:
+//
+//     ultimateBoard game;
+//     uint8_t moves[ultimateBoard::CELLS];
+//     while(game.result() == ONGOING)
+//         game.apply(moves[rand() % game.legalMoves(moves)]);
+
+inline ultimateBoard::ultimateBoard()
+    : myClosed(0),
+      myResult(ONGOING),
+      mySide('x'),
+      myForced(ANY),
+      myNumMoves(0)
+{
+    for(int s = 0; s < 9; s++)
+    {
+        mySubResult[s] = ONGOING;
+    }
+}
+
+inline char ultimateBoard::toMove() const
+{
+    return mySide;
+}
+
+inline int ultimateBoard::forced() const
+{
+    return myForced;
+}
+
+inline gameResult ultimateBoard::result() const
+{
+    return myResult;
+}
+
+inline gameResult ultimateBoard::subResult(int sub) const
+{
+    return mySubResult[sub];
+}
+
+inline const bitboard & ultimateBoard::sub(int sub) const
+{
+    return mySubs[sub];
+}
+
+inline int ultimateBoard::numMoves() const
+{
+    return myNumMoves;
+}
+
+inline bool ultimateBoard::isOpenSub(int sub) const
+{
+    return !bitboard::ops::test(myClosed, sub);
+}
+
+inline bool ultimateBoard::isLegal(int move) const
+// postcondition: returns true if move may be played now
+{
+    if(move < 0 || move >= CELLS || myResult != ONGOING)
+    {
+        return false;
+    }
+    int s = subOf(move);
+    if(myForced != ANY && s != myForced)
+    {
+        return false;
+    }
+    return isOpenSub(s) && mySubs[s].isOpen(cellOf(move));
+}
+
+inline int ultimateBoard::legalMoves(uint8_t * moves) const
+// postcondition: moves holds every legal move; returns how many
+{
+    if(myResult != ONGOING)
+    {
+        return 0;
+    }
+    int n = 0;
+    int first = myForced == ANY ? 0 : myForced;
+    int last = myForced == ANY ? 8 : myForced;
+    for(int s = first; s <= last; s++)
+    {
+        if(!isOpenSub(s))
+        {
+            continue;
+        }
+        int top = (s / 3) * 3, left = (s % 3) * 3;
+        for(bitboard::mask m = mySubs[s].legalMoves(); m; bitboard::ops::clearFirst(m))
+        {
+            int c = bitboard::firstCell(m);
+            moves[n++] = (uint8_t) moveOf(top + c / 3, left + c % 3);
+        }
+    }
+    return n;
+}
+
+inline void ultimateBoard::toMatrix(matrix<char> & grid, char empty) const
+// postcondition: grid is 9 x 9 with 'x', 'o' or empty per cell
+{
+    if(grid.numRows() != SIZE || grid.numCols() != SIZE)
+    {
+        grid.resize(SIZE, SIZE);
+    }
+    for(int move = 0; move < CELLS; move++)
+    {
+        grid[move / SIZE][move % SIZE] = mySubs[subOf(move)].at(cellOf(move), empty);
+    }
+}
+
+inline void ultimateBoard::apply(int move)
+// precondition: isLegal(move)
+{
+    int s = subOf(move), c = cellOf(move);
+    char p = mySide;
+
+    myForcedBefore[myNumMoves] = (int8_t) myForced;
+    myMoves[myNumMoves++] = (uint8_t) move;
+    mySubs[s].apply(c, p);
+
+    // only this small board can have changed
+    gameResult sub = resultAfter(mySubs[s], c, p);
+    if(sub != ONGOING)
+    {
+        mySubResult[s] = sub;
+        myClosed |= bitboard::bit(s);
+        if(sub != DRAW)
+        {
+            myBig.apply(s, p);
+            if(bitboard::rules::winsThrough(myBig.marks(p), s))
+            {
+                myResult = winFor(p);
+            }
+        }
+        if(myResult == ONGOING && myClosed == bitboard::full())
+        {
+            myResult = DRAW;
+        }
+    }
+
+    mySide = (p == 'x') ? 'o' : 'x';
+    myForced = isOpenSub(c) ? c : ANY;
+}
+
+inline void ultimateBoard::undo()
+// precondition: numMoves() > 0
+{
+    int move = myMoves[--myNumMoves];
+    int s = subOf(move);
+    mySubs[s].undo(cellOf(move));
+    if(mySubResult[s] != ONGOING)            // the move decided its board
+    {
+        mySubResult[s] = ONGOING;
+        myClosed &= (bitboard::mask) ~bitboard::bit(s);
+        myBig.undo(s);
+    }
+    myResult = ONGOING;
+    mySide = (mySide == 'x') ? 'o' : 'x';
+    myForced = myForcedBefore[myNumMoves];
+}
+
+inline int ultimateBoard::moveOf(int row, int col)
+{
+    return row * SIZE + col;
+}
+
+inline int ultimateBoard::subOf(int move)
+{
+    return (move / 27) * 3 + (move % SIZE) / 3;
+}
+
+inline int ultimateBoard::cellOf(int move)
+{
+    return ((move / SIZE) % 3) * 3 + (move % 3);
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef _WINLINES_H
+#define _WINLINES_H
+
+#include "bitboard.h"
+using namespace std;
+
+
+// outcome of a position, replaces the old moves == 99 draw sentinel
+enum gameResult
+{
+    ONGOING,                                 // no winner, open cells left
+    X_WINS,                                  // K 'x' in a line
+    O_WINS,                                  // K 'o' in a line
+    DRAW                                     // board full, no winner
+};
+
+// the 3 x 3 tables are generated by rules.h; check they match the game
+static_assert(nkRules<3, 3>::LINES == 8, "3 x 3 has 8 winning lines");
+
+gameResult winFor( char p );
+
+template <int N, int K>
+gameResult resultAfter( const nkBoard<N, K> & pos, int lastCell, char p );
+
+template <int N, int K>
+gameResult resultOf( const nkBoard<N, K> & pos );
+
+
+// *******************************************************************
+// Specifications for win line functions
+//
+//  gameResult winFor( char p );
+//     precondition: p is 'x' or 'o'
+//     postcondition: returns X_WINS or O_WINS
+//
+//  gameResult resultAfter( const nkBoard<N,K> & pos, int lastCell, char p );
+//     precondition: p has just marked lastCell, and the position before
+//                   that move was ONGOING
+//     postcondition: returns the win for p, DRAW or ONGOING; only the
+//                    lines through lastCell are checked
+//
+//  gameResult resultOf( const nkBoard<N,K> & pos );
+//     postcondition: returns the result of an arbitrary position, checking
+//                    every line for both players
+
+inline gameResult winFor(char p)
+// postcondition: returns X_WINS or O_WINS for p
+{
+    return p == 'x' ? X_WINS : O_WINS;
+}
+
+template <int N, int K>
+gameResult resultAfter(const nkBoard<N, K> & pos, int lastCell, char p)
+// precondition: p has just marked lastCell
+// postcondition: returns the win for p, DRAW or ONGOING
+{
+    if(nkRules<N, K>::winsThrough(pos.marks(p), lastCell))
+    {
+        return winFor(p);
+    }
+    return pos.isFull() ? DRAW : ONGOING;
+}
+
+template <int N, int K>
+gameResult resultOf(const nkBoard<N, K> & pos)
+// postcondition: returns the result of an arbitrary position
+{
+    if(nkRules<N, K>::hasWin(pos.marks('x')))
+    {
+        return X_WINS;
+    }
+    if(nkRules<N, K>::hasWin(pos.marks('o')))
+    {
+        return O_WINS;
+    }
+    return pos.isFull() ? DRAW : ONGOING;
+}
+
+#endif
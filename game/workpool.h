@@ -0,0 +1,214 @@
+#ifndef _WORKPOOL_H
+#define _WORKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+
+// work-stealing thread pool.  Each worker owns a task queue; it takes
+// work from the back of its own queue and, when that is empty, steals
+// from the front of another worker's queue.  Tasks receive the index of
+// the worker running them so they can use per-thread state (generators,
+// statistics, solvers) without locking.
+class workPool
+{
+  public:
+
+    typedef function<void ( int worker )> task;
+
+  // constructor/destructor
+    explicit workPool( int threads );        // 0 means one per core
+    ~workPool( );                            // finishes queued work first
+
+  // work
+    void submit( const task & t );           // queue t on the next worker
+    void wait( );                            // until every task has run
+
+  // accessors
+    int size( ) const;                       // number of workers
+
+  private:
+
+    struct queue
+    {
+        mutex lock;
+        deque<task> tasks;
+    };
+
+    workPool( const workPool & );            // not copyable
+    void operator = ( const workPool & );
+
+    void run( int id );
+    bool take( int id, task & t );           // own queue, then steal
+
+    vector<queue *> myQueues;                // one per worker
+    vector<thread> myThreads;
+    atomic<int> myQueued;                    // submitted, not yet taken
+    atomic<int> myPending;                   // submitted, not yet finished
+    atomic<int> myNext;                      // round-robin submit target
+    bool myStop;
+
+    mutex mySleepLock;                       // guards the two below
+    condition_variable myWork;               // queued work or stopping
+    condition_variable myDone;               // pending reached 0
+};
+
+
+// *******************************************************************
+// Specifications for workPool functions
+//
+//  explicit workPool( int threads );
+//     precondition: threads >= 0
+//     postcondition: threads workers are running (hardware_concurrency()
+//                    when threads == 0)
+//
+//  void submit( const task & t );
+//     postcondition: t will run exactly once on some worker
+//
+//  void wait( );
+//     postcondition: every task submitted before the call has finished
+//
+//  Examples of use:
+//
+//     workPool pool(0);
+//     for(int b = 0; b < batches; b++)
+//         pool.submit([&, b](int w) { playBatch(b, stats[w]); });
+//     pool.wait();
+
+inline workPool::workPool(int threads)
+    : myQueued(0),
+      myPending(0),
+      myNext(0),
+      myStop(false)
+{
+    if(threads <= 0)
+    {
+        threads = (int) thread::hardware_concurrency();
+        if(threads <= 0)
+        {
+            threads = 1;
+        }
+    }
+    for(int k = 0; k < threads; k++)
+    {
+        myQueues.push_back(new queue);
+    }
+    for(int k = 0; k < threads; k++)
+    {
+        myThreads.push_back(thread(&workPool::run, this, k));
+    }
+}
+
+inline workPool::~workPool()
+{
+    wait();
+    {
+        lock_guard<mutex> guard(mySleepLock);
+        myStop = true;
+    }
+    myWork.notify_all();
+    for(size_t k = 0; k < myThreads.size(); k++)
+    {
+        myThreads[k].join();
+    }
+    for(size_t k = 0; k < myQueues.size(); k++)
+    {
+        delete myQueues[k];                  // only once no one can steal
+    }
+}
+
+inline void workPool::submit(const task & t)
+// postcondition: t will run exactly once on some worker
+{
+    int target = myNext.fetch_add(1) % size();
+    myPending++;
+    {
+        lock_guard<mutex> guard(mySleepLock);
+        myQueued++;                          // counted before it is visible,
+    }                                        // so myQueued never goes negative
+    {
+        lock_guard<mutex> guard(myQueues[target]->lock);
+        myQueues[target]->tasks.push_back(t);
+    }
+    myWork.notify_one();
+}
+
+inline void workPool::wait()
+// postcondition: every submitted task has finished
+{
+    unique_lock<mutex> guard(mySleepLock);
+    while(myPending.load() > 0)
+    {
+        myDone.wait(guard);
+    }
+}
+
+inline int workPool::size() const
+{
+    return (int) myQueues.size();
+}
+
+inline bool workPool::take(int id, task & t)
+// postcondition: if a task was found it is moved into t and removed
+{
+    {
+        queue & own = *myQueues[id];
+        lock_guard<mutex> guard(own.lock);
+        if(!own.tasks.empty())
+        {
+            t = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    int n = size();
+    for(int k = 1; k < n; k++)
+    {
+        queue & victim = *myQueues[(id + k) % n];
+        lock_guard<mutex> guard(victim.lock);
+        if(!victim.tasks.empty())
+        {
+            t = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void workPool::run(int id)
+{
+    task t;
+    for(;;)
+    {
+        if(take(id, t))
+        {
+            myQueued--;
+            t(id);
+            t = task();
+            if(--myPending == 0)
+            {
+                lock_guard<mutex> guard(mySleepLock);
+                myDone.notify_all();
+            }
+            continue;
+        }
+        unique_lock<mutex> guard(mySleepLock);
+        while(!myStop && myQueued.load() == 0)
+        {
+            myWork.wait(guard);
+        }
+        if(myStop && myQueued.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef _ZOBRIST_H
+#define _ZOBRIST_H
+
+#include <stdint.h>
+using namespace std;
+
+
+// Zobrist hashing: every (player, cell) pair has a random 64-bit key
+// and a position's hash is the XOR of the keys of its marks, so making
+// or undoing a move updates the hash with a single XOR.
+template <int CELLS>
+struct zobristKeys
+{
+    uint64_t key[2][CELLS];                  // [0] = 'x', [1] = 'o'
+
+    constexpr zobristKeys( );
+
+    uint64_t cell( char p, int cell ) const; // key for p marking cell
+};
+
+constexpr uint64_t splitmix64( uint64_t & state );
+
+template <int CELLS>
+struct zobrist
+{
+    static constexpr zobristKeys<CELLS> KEYS = zobristKeys<CELLS>();
+};
+
+
+// *******************************************************************
+// Specifications for zobrist functions
+//
+//  constexpr zobristKeys( );
+//     postcondition: key[][] is filled from a fixed splitmix64 stream, so
+//                    hashes are the same in every build and every process
+//                    (opening books and game records can store them)
+//
+//  uint64_t cell( char p, int cell ) const;
+//     precondition: p is 'x' or 'o', 0 <= cell < CELLS
+//     postcondition: returns the key to XOR in when p marks cell (and to
+//                    XOR out again when the move is undone)
+//
+//  Examples of use:
+//
+//     uint64_t h = 0;
+//     h ^= zobrist<9>::KEYS.cell('x', 4);     // x plays the center
+//     h ^= zobrist<9>::KEYS.cell('x', 4);     // and takes it back: h == 0
+
+constexpr uint64_t splitmix64(uint64_t & state)
+// postcondition: advances state and returns the next value of the stream
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+template <int CELLS>
+constexpr zobristKeys<CELLS>::zobristKeys()
+    : key{ }
+{
+    uint64_t state = 0x7469637461630000ULL + CELLS;
+    for(int p = 0; p < 2; p++)
+    {
+        for(int c = 0; c < CELLS; c++)
+        {
+            key[p][c] = splitmix64(state);
+        }
+    }
+}
+
+template <int CELLS>
+uint64_t zobristKeys<CELLS>::cell(char p, int cell) const
+{
+    return key[p == 'x' ? 0 : 1][cell];
+}
+
+#endif
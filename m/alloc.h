@@ -0,0 +1,382 @@
+#ifndef _ALLOC_H
+#define _ALLOC_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <mutex>
+
+using namespace std;
+
+
+// allocator policies for mlist and matrix.
+//
+// A policy is a class with two static functions:
+//    static void * allocate( size_t bytes );
+//    static void deallocate( void * p, size_t bytes );
+// mlist gets raw storage from its policy and constructs its items in
+// place, so the policy never sees itemType.
+
+// the default: plain operator new / operator delete
+struct heapAlloc
+{
+    static void * allocate( size_t bytes );
+    static void deallocate( void * p, size_t bytes );
+};
+
+// bump arena: allocation is a pointer increment, freeing is a no-op and
+// reset() releases everything at once (e.g. after each search)
+class arena
+{
+  public:
+
+  // constructor/destructor
+    explicit arena( size_t chunkBytes );     // grows in chunks this size
+    ~arena( );
+
+  // allocation
+    void * allocate( size_t bytes );
+    void reset( );                           // forget every allocation
+
+  // accessors
+    size_t used( ) const;                    // bytes handed out since reset
+    static arena * & current( );             // this thread's active arena
+
+  private:
+
+    struct chunk
+    {
+        chunk * next;
+        size_t size;                         // usable bytes after header
+    };
+
+    arena( const arena & );                  // not copyable
+    void operator = ( const arena & );
+
+    chunk * myChunks;                        // newest first
+    char * myNext;                           // next free byte
+    char * myEnd;                            // end of newest chunk
+    size_t myChunkBytes;
+    size_t myUsed;
+};
+
+// switches this thread's current arena for the life of the scope
+class arenaScope
+{
+  public:
+
+    explicit arenaScope( arena & a );
+    ~arenaScope( );
+
+  private:
+
+    arena * myPrevious;
+};
+
+// policy that takes storage from arena::current()
+struct arenaAlloc
+{
+    static void * allocate( size_t bytes );
+    static void deallocate( void * p, size_t bytes );
+};
+
+// fixed-size free-list pool: requests of up to BLOCK bytes are served
+// from per-thread lists of BLOCK-byte blocks carved out of larger slabs,
+// bigger requests go to operator new.  Slabs are never handed back to
+// operator new (a block may still be in use anywhere), but a thread that
+// exits gives its free blocks to a shared spare list that the next
+// refill takes from, so the pool holds at most about the peak number of
+// blocks in use at once plus a slab per live thread, however many
+// threads come and go.
+template <size_t BLOCK>
+struct poolAlloc
+{
+    static void * allocate( size_t bytes );
+    static void deallocate( void * p, size_t bytes );
+
+  private:
+
+    struct block
+    {
+        block * next;
+    };
+
+    // block size rounded up to 16 so every block is suitably aligned
+    static const size_t SIZE = ((BLOCK < sizeof(block) ? sizeof(block) : BLOCK) + 15) & ~(size_t) 15;
+    static const size_t SLAB = 256;          // blocks per refill
+
+    // this thread's free blocks, given to the spares when it exits
+    struct localList
+    {
+        block * head;
+
+        localList( ) : head(0) { }
+        ~localList( );
+    };
+
+    static block * & freeList( );
+    static block * & spares( );              // blocks of exited threads
+    static mutex & sparesLock( );
+    static void refill( block * & head );
+};
+
+
+// *******************************************************************
+// Specifications for allocator policies
+//
+//  static void * heapAlloc::allocate( size_t bytes );
+//     postcondition: returns storage for bytes bytes from operator new
+//
+//  explicit arena( size_t chunkBytes );
+//     precondition: chunkBytes > 0
+//     postcondition: empty arena; storage is obtained chunkBytes at a
+//                    time (or more, for a single larger request)
+//
+//  void * arena::allocate( size_t bytes );
+//     postcondition: returns 16-byte aligned storage for bytes bytes,
+//                    valid until reset() or the arena is destroyed
+//
+//  void arena::reset( );
+//     postcondition: all storage handed out is reusable; the first chunk
+//                    is kept, later ones are freed.  Objects still living
+//                    in the arena must not be used (or destroyed) again
+//
+//  static arena * & arena::current( );
+//     postcondition: returns this thread's active arena pointer (0 if
+//                    none); arenaScope sets and restores it
+//
+//  static void * arenaAlloc::allocate( size_t bytes );
+//     precondition: arena::current() != 0
+//     postcondition: returns storage from the current arena; deallocate
+//                    does nothing
+//
+//  static void * poolAlloc<BLOCK>::allocate( size_t bytes );
+//     postcondition: bytes <= BLOCK: pops a block off this thread's free
+//                    list (refilling it from the spares, or else with a
+//                    new slab, when empty); larger requests use operator
+//                    new
+//
+//  static void poolAlloc<BLOCK>::deallocate( void * p, size_t bytes );
+//     precondition: p came from allocate(bytes), on any thread
+//     postcondition: small blocks go on this thread's free list (so a
+//                    block freed by another thread moves to that thread,
+//                    and back to the spares when it exits)
+//
+//  Examples of use:
+//
+//     arena scratch(1 << 20);
+//     {
+//         arenaScope use(scratch);
+//         matrix<char, arenaAlloc> copy(3, 3, ' ');   // no malloc
+//         ...
+//     }
+//     scratch.reset();
+//
+//     matrix<char, poolAlloc<64> > board(3, 3, ' ');  // no malloc once warm
+
+inline void * heapAlloc::allocate(size_t bytes)
+{
+    return ::operator new(bytes);
+}
+
+inline void heapAlloc::deallocate(void * p, size_t)
+{
+    ::operator delete(p);
+}
+
+inline arena::arena(size_t chunkBytes)
+    : myChunks(0),
+      myNext(0),
+      myEnd(0),
+      myChunkBytes(chunkBytes),
+      myUsed(0)
+{
+
+}
+
+inline arena::~arena()
+{
+    while(myChunks)
+    {
+        chunk * next = myChunks->next;
+        ::operator delete(myChunks);
+        myChunks = next;
+    }
+}
+
+inline void * arena::allocate(size_t bytes)
+// postcondition: returns 16-byte aligned storage for bytes bytes
+{
+    bytes = (bytes + 15) & ~(size_t) 15;
+    if(myNext == 0 || (size_t) (myEnd - myNext) < bytes)
+    {
+        size_t size = bytes > myChunkBytes ? bytes : myChunkBytes;
+        size_t header = (sizeof(chunk) + 15) & ~(size_t) 15;
+        chunk * c = (chunk *) ::operator new(header + size);
+        c->next = myChunks;
+        c->size = size;
+        myChunks = c;
+        myNext = (char *) c + header;
+        myEnd = myNext + size;
+    }
+    void * p = myNext;
+    myNext += bytes;
+    myUsed += bytes;
+    return p;
+}
+
+inline void arena::reset()
+// postcondition: all storage is reusable, only the oldest chunk is kept
+{
+    while(myChunks && myChunks->next)
+    {
+        chunk * next = myChunks->next;
+        ::operator delete(myChunks);
+        myChunks = next;
+    }
+    if(myChunks)
+    {
+        size_t header = (sizeof(chunk) + 15) & ~(size_t) 15;
+        myNext = (char *) myChunks + header;
+        myEnd = myNext + myChunks->size;
+    }
+    myUsed = 0;
+}
+
+inline size_t arena::used() const
+{
+    return myUsed;
+}
+
+inline arena * & arena::current()
+{
+    static thread_local arena * active = 0;
+    return active;
+}
+
+inline arenaScope::arenaScope(arena & a)
+    : myPrevious(arena::current())
+{
+    arena::current() = &a;
+}
+
+inline arenaScope::~arenaScope()
+{
+    arena::current() = myPrevious;
+}
+
+inline void * arenaAlloc::allocate(size_t bytes)
+// precondition: arena::current() != 0
+{
+    if(arena::current() == 0)
+    {
+        cerr << "arenaAlloc used with no current arena" << endl;
+        exit(1);
+    }
+    return arena::current()->allocate(bytes);
+}
+
+inline void arenaAlloc::deallocate(void *, size_t)
+{
+    // freed all at once by arena::reset
+}
+
+template <size_t BLOCK>
+poolAlloc<BLOCK>::localList::~localList()
+// postcondition: this thread's free blocks are on the spare list
+{
+    if(head == 0)
+    {
+        return;
+    }
+    block * last = head;
+    while(last->next)
+    {
+        last = last->next;
+    }
+    lock_guard<mutex> guard(sparesLock());
+    last->next = spares();
+    spares() = head;
+    head = 0;
+}
+
+template <size_t BLOCK>
+typename poolAlloc<BLOCK>::block * & poolAlloc<BLOCK>::freeList()
+{
+    static thread_local localList list;
+    return list.head;
+}
+
+template <size_t BLOCK>
+typename poolAlloc<BLOCK>::block * & poolAlloc<BLOCK>::spares()
+{
+    static block * head = 0;
+    return head;
+}
+
+template <size_t BLOCK>
+mutex & poolAlloc<BLOCK>::sparesLock()
+{
+    static mutex lock;
+    return lock;
+}
+
+template <size_t BLOCK>
+void poolAlloc<BLOCK>::refill(block * & head)
+// precondition: head == 0
+// postcondition: head holds the spare blocks, or a new slab if there were none
+{
+    {
+        lock_guard<mutex> guard(sparesLock());
+        head = spares();
+        spares() = 0;
+    }
+    if(head)
+    {
+        return;
+    }
+    char * slab = (char *) ::operator new(SIZE * SLAB);
+    for(size_t k = 0; k < SLAB; k++)
+    {
+        block * b = (block *) (slab + k * SIZE);
+        b->next = head;
+        head = b;
+    }
+}
+
+template <size_t BLOCK>
+void * poolAlloc<BLOCK>::allocate(size_t bytes)
+{
+    if(bytes > SIZE)
+    {
+        return ::operator new(bytes);
+    }
+    block * & head = freeList();
+    if(head == 0)
+    {
+        refill(head);
+    }
+    block * b = head;
+    head = b->next;
+    return b;
+}
+
+template <size_t BLOCK>
+void poolAlloc<BLOCK>::deallocate(void * p, size_t bytes)
+{
+    if(p == 0)
+    {
+        return;
+    }
+    if(bytes > SIZE)
+    {
+        ::operator delete(p);
+        return;
+    }
+    block * b = (block *) p;
+    b->next = freeList();
+    freeList() = b;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef _INDEXING_H
+#define _INDEXING_H
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+
+// index checking for mlist, matrix and matrixRow operator [].
+//
+// The level is picked once per build with -DINDEX_CHECKS=<level>:
+//    INDEX_CHECKED    range check, message on cerr and exit (the default)
+//    INDEX_ASSERT     assert() only: checked in debug builds, free with
+//                     -DNDEBUG
+//    INDEX_UNCHECKED  no check at all, [] is a plain array access
+// at() is always checked and throws out_of_range instead of exiting.
+
+#define INDEX_UNCHECKED 0
+#define INDEX_ASSERT    1
+#define INDEX_CHECKED   2
+
+#ifndef INDEX_CHECKS
+#define INDEX_CHECKS INDEX_CHECKED
+#endif
+
+// prints "<what><k> max index = <size-1>" on cerr and exits
+[[noreturn]] void indexError( const char * what, int k, int size );
+
+// operator [] check at the INDEX_CHECKS level
+void checkIndex( const char * what, int k, int size );
+
+// at() check: throws out_of_range carrying the same message
+void checkIndexAt( const char * what, int k, int size );
+
+
+// *******************************************************************
+// Specifications for index checking functions
+//
+//  void checkIndex( const char * what, int k, int size );
+//     precondition: 0 <= k < size (enforced according to INDEX_CHECKS)
+//     postcondition: returns normally when k is in range; otherwise
+//                    INDEX_CHECKED reports and exits, INDEX_ASSERT
+//                    asserts, INDEX_UNCHECKED does nothing
+//
+//  void checkIndexAt( const char * what, int k, int size );
+//     postcondition: returns normally when 0 <= k < size, otherwise
+//                    throws out_of_range; independent of INDEX_CHECKS
+//
+//  Examples of use:
+//
+//     g++ -std=c++17 -O2 main.cpp                      // checked
+//     g++ -std=c++17 -O2 -DINDEX_CHECKS=1 main.cpp     // asserts
+//     g++ -std=c++17 -O2 -DINDEX_CHECKS=0 main.cpp     // no branches
+
+inline void indexError(const char * what, int k, int size)
+{
+    cerr << what << k << " max index = " << (size - 1) << endl;
+    exit(1);
+}
+
+inline void checkIndex(const char * what, int k, int size)
+// precondition: 0 <= k < size
+{
+#if INDEX_CHECKS == INDEX_CHECKED
+    if ((unsigned) k >= (unsigned) size)    // one compare covers k < 0 too
+    {
+        indexError(what, k, size);
+    }
+#elif INDEX_CHECKS == INDEX_ASSERT
+    (void) what;
+    assert(0 <= k && k < size);
+#else
+    (void) what;
+    (void) k;
+    (void) size;
+#endif
+}
+
+inline void checkIndexAt(const char * what, int k, int size)
+// postcondition: throws out_of_range unless 0 <= k < size
+{
+    if ((unsigned) k >= (unsigned) size)
+    {
+        throw out_of_range(what + to_string(k) + " max index = " + to_string(size - 1));
+    }
+}
+
+#endif
@@ -0,0 +1,480 @@
+#ifndef _INSTRUMENT_H
+#define _INSTRUMENT_H
+
+#include "stathooks.h"
+
+#if INSTRUMENT
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+// the instrumentation behind the STAT_ hooks (m/stathooks.h): per-thread
+// counters and latency histograms, snapshots that add them up and write
+// them as JSON or Prometheus text, and a reporter thread that does so
+// periodically.  All of it exists only with -DINSTRUMENT=1; otherwise
+// this header is just the hooks, which expand to empty statements.
+// Each thread counts into its own block.
+
+const int STAT_BUCKETS = 40;                 // bucket k: [2^k, 2^(k+1)) ns
+
+// one thread's counts; only that thread writes, snapshots read
+struct statBlock
+{
+    atomic<uint64_t> counter[STAT_COUNTERS];
+    atomic<uint64_t> bucket[STAT_HISTOGRAMS][STAT_BUCKETS];
+    atomic<uint64_t> sum[STAT_HISTOGRAMS];   // total ns
+
+    statBlock( );
+
+    void add( statCounter c, uint64_t n );
+    void record( statHistogram h, uint64_t ns );
+};
+
+// the blocks of every thread, added up
+struct statSnapshot
+{
+    uint64_t counter[STAT_COUNTERS];
+    uint64_t bucket[STAT_HISTOGRAMS][STAT_BUCKETS];
+    uint64_t sum[STAT_HISTOGRAMS];
+
+    statSnapshot( );
+
+    uint64_t count( statHistogram h ) const;
+    uint64_t percentile( statHistogram h, double fraction ) const;
+    void writeJson( ostream & out ) const;
+    void writePrometheus( ostream & out ) const;
+
+    static statSnapshot take( );
+};
+
+// times its own lifetime into a histogram
+class statScope
+{
+  public:
+
+    explicit statScope( statHistogram h );
+    ~statScope( );
+
+  private:
+
+    statScope( const statScope & );          // not copyable
+    void operator = ( const statScope & );
+
+    statHistogram myHist;
+    chrono::steady_clock::time_point myStart;
+};
+
+// writes a snapshot to a file every period, and once more when destroyed
+class statReporter
+{
+  public:
+
+  // constructor/destructor
+    statReporter( );
+    ~statReporter( );                        // stops and writes the last one
+
+  // reporting
+    bool start( const string & path, int periodMs );
+    void stop( );
+    bool writeNow( );
+
+  private:
+
+    statReporter( const statReporter & );    // not copyable
+    void operator = ( const statReporter & );
+
+    void run( );
+
+    string myPath;
+    bool myJson;                             // .json, otherwise Prometheus
+    int myPeriod;                            // ms
+    thread myThread;
+    mutex myLock;
+    condition_variable myWake;
+    bool myStop;
+};
+
+statBlock & statThread( );                   // the calling thread's block
+const char * statCounterName( statCounter c );
+const char * statHistogramName( statHistogram h );
+
+
+// *******************************************************************
+// Specifications for instrumentation
+//
+//  STAT_COUNT( c );  STAT_ADD( c, n );
+//     postcondition: with INSTRUMENT on, the calling thread's counter c
+//                    has grown by 1 (or n); otherwise nothing happens
+//
+//  STAT_TIME( h );
+//     postcondition: with INSTRUMENT on, the time from here to the end
+//                    of the enclosing block is added to histogram h of
+//                    the calling thread; otherwise nothing happens
+//
+//  static statSnapshot take( );
+//     postcondition: returns the sum of every thread's block so far.
+//                    Counts are read with relaxed loads, so a snapshot
+//                    taken while threads run may be a few counts behind.
+//
+//  uint64_t percentile( statHistogram h, double fraction ) const;
+//     postcondition: returns the upper edge in ns of the bucket holding
+//                    that fraction of h's samples (0 if there are none)
+//
+//  void writeJson( ostream & out ) const;
+//     postcondition: one JSON object: counters by name, and per
+//                    histogram its count, sum_ns, p50_ns, p99_ns and
+//                    buckets (the upper edge in ns and a count for each
+//                    non-empty bucket)
+//
+//  void writePrometheus( ostream & out ) const;
+//     postcondition: Prometheus text: ttt_<counter>_total per counter
+//                    and a ttt_<histogram>_seconds histogram each
+//
+//  bool start( const string & path, int periodMs );
+//     precondition: periodMs > 0
+//     postcondition: a thread rewrites path with a fresh snapshot every
+//                    periodMs (JSON when path ends in .json); the file is
+//                    written aside and renamed, so readers never see half
+//                    of one.  Returns false if path can't be written.
+//
+//  Examples of use:
+//
+//     bool validMove(...)
+//     {
+//         STAT_TIME(HIST_VALID_MOVE);
+//         STAT_COUNT(STAT_MOVES_CHECKED);
+//         ...
+//     }
+//
+//     g++ -std=c++17 -O2 -DINSTRUMENT=1 main.cpp -o main
+//     ./main --stats stats.prom
+
+inline const char * statCounterName(statCounter c)
+{
+    static const char * names[STAT_COUNTERS] =
+    {
+        "moves_checked", "moves_rejected", "input_retries",
+        "win_checks", "mlist_allocs", "mlist_bytes",
+        "book_hits", "cache_hits", "cache_misses"
+    };
+    return names[c];
+}
+
+inline const char * statHistogramName(statHistogram h)
+{
+    static const char * names[STAT_HISTOGRAMS] =
+    {
+        "valid_move", "win_check", "move_input"
+    };
+    return names[h];
+}
+
+inline statBlock::statBlock()
+{
+    for(int c = 0; c < STAT_COUNTERS; c++)
+    {
+        counter[c] = 0;
+    }
+    for(int h = 0; h < STAT_HISTOGRAMS; h++)
+    {
+        sum[h] = 0;
+        for(int b = 0; b < STAT_BUCKETS; b++)
+        {
+            bucket[h][b] = 0;
+        }
+    }
+}
+
+inline void statBlock::add(statCounter c, uint64_t n)
+{
+    // only this thread writes, so no locked add is needed
+    counter[c].store(counter[c].load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+inline void statBlock::record(statHistogram h, uint64_t ns)
+{
+    int b = 63 - __builtin_clzll(ns | 1);
+    if(b >= STAT_BUCKETS)
+    {
+        b = STAT_BUCKETS - 1;
+    }
+    bucket[h][b].store(bucket[h][b].load(memory_order_relaxed) + 1, memory_order_relaxed);
+    sum[h].store(sum[h].load(memory_order_relaxed) + ns, memory_order_relaxed);
+}
+
+// every block ever handed out; blocks outlive their threads so that
+// work done by finished threads still shows up in snapshots.  The
+// registry is never destroyed, so reporters in globals can still take a
+// last snapshot while the program exits.
+inline mutex & statRegistryLock()
+{
+    static mutex * lock = new mutex;
+    return *lock;
+}
+
+inline vector<statBlock *> & statRegistry()
+{
+    static vector<statBlock *> * blocks = new vector<statBlock *>;
+    return *blocks;
+}
+
+inline statBlock & statThread()
+{
+    thread_local statBlock * mine = 0;
+    if(mine == 0)
+    {
+        mine = new statBlock;
+        lock_guard<mutex> guard(statRegistryLock());
+        statRegistry().push_back(mine);
+    }
+    return *mine;
+}
+
+inline statSnapshot::statSnapshot()
+{
+    for(int c = 0; c < STAT_COUNTERS; c++)
+    {
+        counter[c] = 0;
+    }
+    for(int h = 0; h < STAT_HISTOGRAMS; h++)
+    {
+        sum[h] = 0;
+        for(int b = 0; b < STAT_BUCKETS; b++)
+        {
+            bucket[h][b] = 0;
+        }
+    }
+}
+
+inline statSnapshot statSnapshot::take()
+{
+    statSnapshot s;
+    lock_guard<mutex> guard(statRegistryLock());
+    vector<statBlock *> & blocks = statRegistry();
+    for(size_t k = 0; k < blocks.size(); k++)
+    {
+        const statBlock & b = *blocks[k];
+        for(int c = 0; c < STAT_COUNTERS; c++)
+        {
+            s.counter[c] += b.counter[c].load(memory_order_relaxed);
+        }
+        for(int h = 0; h < STAT_HISTOGRAMS; h++)
+        {
+            s.sum[h] += b.sum[h].load(memory_order_relaxed);
+            for(int n = 0; n < STAT_BUCKETS; n++)
+            {
+                s.bucket[h][n] += b.bucket[h][n].load(memory_order_relaxed);
+            }
+        }
+    }
+    return s;
+}
+
+inline uint64_t statSnapshot::count(statHistogram h) const
+{
+    uint64_t n = 0;
+    for(int b = 0; b < STAT_BUCKETS; b++)
+    {
+        n += bucket[h][b];
+    }
+    return n;
+}
+
+inline uint64_t statSnapshot::percentile(statHistogram h, double fraction) const
+{
+    uint64_t total = count(h);
+    if(total == 0)
+    {
+        return 0;
+    }
+    uint64_t wanted = (uint64_t) (total * fraction);
+    if(wanted >= total)
+    {
+        wanted = total - 1;
+    }
+    uint64_t seen = 0;
+    for(int b = 0; b < STAT_BUCKETS; b++)
+    {
+        seen += bucket[h][b];
+        if(seen > wanted)
+        {
+            return 2ULL << b;
+        }
+    }
+    return 2ULL << (STAT_BUCKETS - 1);
+}
+
+inline void statSnapshot::writeJson(ostream & out) const
+{
+    out << "{\"instrumented\":" << (INSTRUMENT ? "true" : "false") << ",\"counters\":{";
+    for(int c = 0; c < STAT_COUNTERS; c++)
+    {
+        out << (c ? "," : "") << '"' << statCounterName((statCounter) c) << "\":" << counter[c];
+    }
+    out << "},\"histograms\":{";
+    for(int h = 0; h < STAT_HISTOGRAMS; h++)
+    {
+        statHistogram hist = (statHistogram) h;
+        out << (h ? "," : "") << '"' << statHistogramName(hist) << "\":{"
+            << "\"count\":" << count(hist)
+            << ",\"sum_ns\":" << sum[h]
+            << ",\"p50_ns\":" << percentile(hist, 0.50)
+            << ",\"p99_ns\":" << percentile(hist, 0.99)
+            << ",\"buckets\":[";
+        bool first = true;
+        for(int b = 0; b < STAT_BUCKETS; b++)
+        {
+            if(bucket[h][b] == 0)
+            {
+                continue;
+            }
+            out << (first ? "" : ",") << '[' << (2ULL << b) << ',' << bucket[h][b] << ']';
+            first = false;
+        }
+        out << "]}";
+    }
+    out << "}}\n";
+}
+
+inline void statSnapshot::writePrometheus(ostream & out) const
+{
+    for(int c = 0; c < STAT_COUNTERS; c++)
+    {
+        const char * name = statCounterName((statCounter) c);
+        out << "# TYPE ttt_" << name << "_total counter\n"
+            << "ttt_" << name << "_total " << counter[c] << "\n";
+    }
+    for(int h = 0; h < STAT_HISTOGRAMS; h++)
+    {
+        const char * name = statHistogramName((statHistogram) h);
+        out << "# TYPE ttt_" << name << "_seconds histogram\n";
+        uint64_t seen = 0;
+        for(int b = 0; b < STAT_BUCKETS; b++)
+        {
+            seen += bucket[h][b];
+            out << "ttt_" << name << "_seconds_bucket{le=\"" << (2ULL << b) * 1e-9
+                << "\"} " << seen << "\n";
+        }
+        out << "ttt_" << name << "_seconds_bucket{le=\"+Inf\"} " << seen << "\n"
+            << "ttt_" << name << "_seconds_sum " << sum[h] * 1e-9 << "\n"
+            << "ttt_" << name << "_seconds_count " << seen << "\n";
+    }
+}
+
+inline statScope::statScope(statHistogram h)
+    : myHist(h),
+      myStart(chrono::steady_clock::now())
+{
+
+}
+
+inline statScope::~statScope()
+{
+    chrono::steady_clock::duration d = chrono::steady_clock::now() - myStart;
+    statThread().record(myHist, (uint64_t) chrono::duration_cast<chrono::nanoseconds>(d).count());
+}
+
+inline statReporter::statReporter()
+    : myJson(false),
+      myPeriod(1000),
+      myStop(false)
+{
+
+}
+
+inline statReporter::~statReporter()
+{
+    stop();
+}
+
+inline bool statReporter::start(const string & path, int periodMs)
+// precondition: periodMs > 0
+{
+    stop();
+    myPath = path;
+    myJson = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    myPeriod = periodMs;
+    if(!writeNow())
+    {
+        myPath.clear();
+        return false;
+    }
+    myStop = false;
+    myThread = thread(&statReporter::run, this);
+    return true;
+}
+
+inline void statReporter::stop()
+// postcondition: the thread has finished and the last snapshot is written
+{
+    if(myThread.joinable())
+    {
+        {
+            lock_guard<mutex> guard(myLock);
+            myStop = true;
+        }
+        myWake.notify_all();
+        myThread.join();
+    }
+    if(!myPath.empty())
+    {
+        writeNow();
+        myPath.clear();
+    }
+}
+
+inline bool statReporter::writeNow()
+// postcondition: myPath holds a fresh snapshot, replaced in one rename
+{
+    string temp = myPath + ".tmp";
+    {
+        ofstream out(temp.c_str());
+        if(!out)
+        {
+            return false;
+        }
+        statSnapshot s = statSnapshot::take();
+        if(myJson)
+        {
+            s.writeJson(out);
+        }
+        else
+        {
+            s.writePrometheus(out);
+        }
+        if(!out)
+        {
+            return false;
+        }
+    }
+    return rename(temp.c_str(), myPath.c_str()) == 0;
+}
+
+inline void statReporter::run()
+{
+    unique_lock<mutex> guard(myLock);
+    while(!myStop)
+    {
+        if(myWake.wait_for(guard, chrono::milliseconds(myPeriod)) == cv_status::timeout && !myStop)
+        {
+            guard.unlock();
+            writeNow();
+            guard.lock();
+        }
+    }
+}
+
+#endif // INSTRUMENT
+
+#endif
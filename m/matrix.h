@@ -5,29 +5,51 @@
 using namespace std;
 
 
-template <class itemType>
+// storage layouts (third template parameter of matrix)
+struct rowLayout { };      // one mlist per row: a row array plus a heap block
+                           // per row, [] returns the row's mlist
+struct flatLayout { };     // every item in one row-major buffer, [] returns
+                           // a matrixRow view into it
+
+template <class itemType> class matrixRow;
+template <class itemType, class allocPolicy, class layout> class matrixStorage;
+
+template <class itemType, class allocPolicy = heapAlloc, class layout = flatLayout>
 class matrix
 {
   public:
 
+    typedef matrixStorage<itemType, allocPolicy, layout> storage;
+    typedef typename storage::rowType rowType;           // what [] returns
+    typedef typename storage::constRowType constRowType;
+
   // constructors/destructor
     matrix( );                                      // default size 0 x 0
     matrix( int rows, int cols );                   // size rows x cols
     matrix( int rows, int cols,
             const itemType & fillValue );           // all entries == fillValue
     matrix( const matrix & mat );                   // copy constructor
+    matrix( matrix && mat ) noexcept;               // move constructor
     ~matrix( );                                     // destructor
 
   // assignment
     const matrix & operator = ( const matrix & rhs );
+    const matrix & operator = ( matrix && rhs ) noexcept;
+    void swap( matrix & mat ) noexcept;         // exchange contents, no copying
 
   // accessors
     int numRows( ) const;                             // number of rows
     int numCols( ) const;                             // number of columns
 
   // indexing
-    const mlist<itemType> & operator [ ] ( int k ) const;  // range-checked indexing
-    mlist<itemType> & operator [ ] ( int k );              // range-checked indexing
+    constRowType operator [ ] ( int k ) const;  // checked per INDEX_CHECKS
+    rowType operator [ ] ( int k );             // checked per INDEX_CHECKS
+    itemType & at( int row, int col );          // always checked, throws
+    const itemType & at( int row, int col ) const;
+
+  // raw access (flatLayout only)
+    itemType * data( );                         // row-major items
+    const itemType * data( ) const;
 
   // modifiers
     void resize( int newRows, int newCols );   // resizes matrix to newRows x newCols
@@ -36,7 +58,31 @@ class matrix
 
     int myRows;                             // # of rows (capacity)
     int myCols;                             // # of cols (capacity)
-    mlist<mlist<itemType> > myMatrix; // the matrix of items
+    storage myMatrix;                       // the matrix of items
+};
+
+template <class itemType, class allocPolicy, class layout>
+void swap( matrix<itemType, allocPolicy, layout> & a,
+           matrix<itemType, allocPolicy, layout> & b ) noexcept;
+
+// a view of one row of a flatLayout matrix; itemType is const for rows
+// of a const matrix.  Cheap to copy, valid until the matrix is resized.
+template <class itemType>
+class matrixRow
+{
+  public:
+
+    matrixRow( itemType * first, int cols );
+
+    itemType & operator [ ] ( int k ) const;    // checked per INDEX_CHECKS
+    itemType & at( int k ) const;               // always checked, throws
+    int size( ) const;                          // number of columns
+    itemType * data( ) const;                   // first item of the row
+
+  private:
+
+    itemType * myFirst;
+    int myCols;
 };
 
 
@@ -44,10 +90,19 @@ class matrix
 // Specifications for matrix functions
 //
 // To use this class, itemType must satisfy the same constraints
-// as formlist class.
+// as formlist class.  allocPolicy is passed on to every mlist, so the
+// rows and the row array all come from the same allocator (see alloc.h).
+//
+// layout picks the storage.  flatLayout (the default) keeps all
+// rows*cols items in a single row-major buffer: one allocation per
+// matrix, one indirection per access and full-board scans walk memory
+// in order.  rowLayout is the original row-of-mlists form.  Code that
+// only uses board[row][col], numRows() and numCols() works with both.
 //
 // Any violation of a function's precondition will result in an error  message
-// followed by a call to exit.
+// followed by a call to exit.  Row and column checks in operator [ ] follow
+// the INDEX_CHECKS build mode (see indexing.h); with INDEX_UNCHECKED
+// board[r][c] compiles to a plain load.  at() is checked in every build.
 //
 // constructors/destructor
 //
@@ -68,6 +123,9 @@ class matrix
 //  matrix( const matrix<itemType> & mat );
 //     postcondition: matrix is a copy of mat
 //
+//  matrix( matrix<itemType> && mat ) noexcept;
+//     postcondition: matrix has mat's items and storage; mat is 0 x 0
+//
 //  ~matrix( );
 //     postcondition: matrix is destroyed
 //
@@ -75,9 +133,17 @@ class matrix
 //
 //  const matrix & operator = ( const matrix & rhs );
 //     postcondition: normal assignment via copying has been performed
-//                    (if matrix and rhs were different sizes, matrix has 
+//                    (if matrix and rhs were different sizes, matrix has
 //                    been resized to match the size of rhs)
 //
+//  const matrix & operator = ( matrix && rhs ) noexcept;
+//     postcondition: matrix has rhs's items and storage; rhs is 0 x 0
+//
+//  void swap( matrix & mat ) noexcept;
+//     postcondition: matrix and mat have exchanged sizes and items;
+//                    nothing is copied, so returning a matrix from a
+//                    function or keeping one in a container is cheap
+//
 // accessors
 //
 //  int numRows( ) const;
@@ -88,13 +154,23 @@ class matrix
 //
 // indexing
 //
-//  const mlist<itemType> & operator [ ] ( int k ) const;
+//  constRowType operator [ ] ( int k ) const;
 //     precondition: 0 <= k < number of rows
 //     postcondition: returns k-th row
 //
-//  mlist<itemType> & operator [ ] ( int k );
+//  rowType operator [ ] ( int k );
 //     precondition: 0 <= k < number of rows
-//     postcondition: returns k-th row
+//     postcondition: returns k-th row (an mlist reference for rowLayout,
+//                    a matrixRow view for flatLayout)
+//
+//  itemType & at( int row, int col );
+//     postcondition: returns the item at (row, col); throws out_of_range
+//                    unless 0 <= row < numRows() and 0 <= col < numCols()
+//
+//  itemType * data( );
+//     precondition: layout is flatLayout
+//     postcondition: returns the first item; item (r,c) is at
+//                    data()[r * numCols() + c] (0 for an empty matrix)
 //
 // modifiers
 //
@@ -115,121 +191,285 @@ class matrix
 //     matrix<double> dzmat( 100, 80, 0.0 ); // initialized to 0.0
 //     matrix<apstring> smat( 300, 1 );      // 300 strings
 //     matrix<int> imat;                     // has room for 0 ints
+//     matrix<char, poolAlloc<64> > board(3, 3, ' '); // rows from a pool
+//     matrix<int, heapAlloc, rowLayout> rows(4, 4);   // one block per row
 
+// storage for rowLayout: the original mlist of mlists
+template <class itemType, class allocPolicy>
+class matrixStorage<itemType, allocPolicy, rowLayout>
+{
+  public:
+
+    typedef mlist<itemType, allocPolicy> & rowType;
+    typedef const mlist<itemType, allocPolicy> & constRowType;
+
+    void create( int rows, int cols )
+    {
+        myRows.resize(rows);
+        for(int k = 0; k < rows; k++)
+        {
+            myRows[k].resize(cols);
+        }
+    }
+
+    rowType row( int k, int )                   { return myRows[k]; }
+    constRowType row( int k, int ) const        { return myRows[k]; }
+
+    void resize( int, int, int newRows, int newCols )
+    {
+        create(newRows, newCols);               // mlist::resize keeps values
+    }
+
+    void swap( matrixStorage & other ) noexcept { myRows.swap(other.myRows); }
+
+  private:
+
+    mlist<mlist<itemType, allocPolicy>, allocPolicy> myRows;
+};
+
+// storage for flatLayout: one row-major buffer
+template <class itemType, class allocPolicy>
+class matrixStorage<itemType, allocPolicy, flatLayout>
+{
+  public:
+
+    typedef matrixRow<itemType> rowType;
+    typedef matrixRow<const itemType> constRowType;
+
+    void create( int rows, int cols )
+    {
+        myCells.resize(rows * cols);
+    }
+
+    rowType row( int k, int cols )              { return rowType(data() + k * cols, cols); }
+    constRowType row( int k, int cols ) const   { return constRowType(data() + k * cols, cols); }
+
+    itemType * data( )
+    {
+        return myCells.size() > 0 ? &myCells[0] : 0;
+    }
+
+    const itemType * data( ) const
+    {
+        return myCells.size() > 0 ? &myCells[0] : 0;
+    }
+
+    void resize( int oldRows, int oldCols, int newRows, int newCols )
+    {
+        if(oldCols == newCols)
+        {
+            myCells.resize(newRows * newCols);  // rows stay where they are
+            return;
+        }
+        mlist<itemType, allocPolicy> fresh(newRows * newCols);
+        int rows = oldRows < newRows ? oldRows : newRows;
+        int cols = oldCols < newCols ? oldCols : newCols;
+        for(int j = 0; j < rows; j++)
+        {
+            for(int k = 0; k < cols; k++)
+            {
+                fresh[j * newCols + k] = myCells[j * oldCols + k];
+            }
+        }
+        myCells.swap(fresh);                    // old buffer goes with fresh
+    }
+
+    void swap( matrixStorage & other ) noexcept { myCells.swap(other.myCells); }
+
+  private:
+
+    mlist<itemType, allocPolicy> myCells;
+};
+
+template <class itemType>
+matrixRow<itemType>::matrixRow(itemType * first, int cols)
+    : myFirst(first),
+      myCols(cols)
+{
+
+}
+
+template <class itemType>
+itemType & matrixRow<itemType>::operator [] (int k) const
+// precondition: 0 <= k < number of columns
+// postcondition: returns the k-th item of the row
+{
+    checkIndex("Illegal matrix column index: ", k, myCols);
+    return myFirst[k];
+}
+
 template <class itemType>
-matrix<itemType>::matrix()
+itemType & matrixRow<itemType>::at(int k) const
+// postcondition: returns the k-th item of the row
+// exception: throws out_of_range unless 0 <= k < number of columns
+{
+    checkIndexAt("Illegal matrix column index: ", k, myCols);
+    return myFirst[k];
+}
+
+template <class itemType>
+int matrixRow<itemType>::size() const
+{
+    return myCols;
+}
+
+template <class itemType>
+itemType * matrixRow<itemType>::data() const
+{
+    return myFirst;
+}
+
+template <class itemType, class allocPolicy, class layout>
+matrix<itemType, allocPolicy, layout>::matrix()
 		  : myRows(0),
-			 myCols(0),
-			 myMatrix(0)
+			 myCols(0)
 
 // postcondition: matrix of size 0x0 is constructed, and therefore
 //                will need to be resized later
 {
 
 }
-template <class itemType>
-matrix<itemType>::matrix(int rows,int cols)
+template <class itemType, class allocPolicy, class layout>
+matrix<itemType, allocPolicy, layout>::matrix(int rows,int cols)
 		  : myRows(rows),
-			 myCols(cols),
-			 myMatrix(rows)
-     
+			 myCols(cols)
+
 // precondition: 0 <= rows and 0 <= cols
 // postcondition: matrix of size rows x cols is constructed
 {
-    int k;
-    for(k=0; k < rows; k++)
-    {
-        myMatrix[k].resize(cols);
-    }
+    myMatrix.create(rows, cols);
 }
 
-template <class itemType>
-matrix<itemType>::matrix(int rows, int cols, const itemType & fillValue)
+template <class itemType, class allocPolicy, class layout>
+matrix<itemType, allocPolicy, layout>::matrix(int rows, int cols, const itemType & fillValue)
         : myRows(rows),
-          myCols(cols),
-          myMatrix(rows)
-     
+          myCols(cols)
+
 // precondition: 0 <= rows and 0 <= cols
 // postcondition: matrix of size rows x cols is constructed
 //                all entries are set by assignment to fillValue after
 //                default construction
-//     
+//
 {
+    myMatrix.create(rows, cols);
     int j,k;
     for(j=0; j < rows; j++)
     {
-        myMatrix[j].resize(cols);
+        rowType row = myMatrix.row(j, cols);
         for(k=0; k < cols; k++)
         {
-            myMatrix[j][k] = fillValue;
+            row[k] = fillValue;
         }
     }
 }
 
-template <class itemType>
-matrix<itemType>::matrix(const matrix<itemType> & mat)
+template <class itemType, class allocPolicy, class layout>
+matrix<itemType, allocPolicy, layout>::matrix(const matrix<itemType, allocPolicy, layout> & mat)
     : myRows(mat.myRows),
       myCols(mat.myCols),
-      myMatrix(mat.myRows)
-     
+      myMatrix(mat.myMatrix)
+
 // postcondition: matrix is a copy of mat
 {
-    int k;
-    // copy elements
-    for(k = 0; k < myRows; k++)
-    {
-        // cast to avoid const problems (const -> non-const)
-        myMatrix[k] = (mlist<itemType> &) mat.myMatrix[k];
-    }   
+
 }
 
-template <class itemType>
-matrix<itemType>::~matrix ()
+template <class itemType, class allocPolicy, class layout>
+matrix<itemType, allocPolicy, layout>::matrix(matrix<itemType, allocPolicy, layout> && mat) noexcept
+    : myRows(mat.myRows),
+      myCols(mat.myCols),
+      myMatrix(std::move(mat.myMatrix))
+
+// postcondition: matrix has mat's items and storage; mat is 0 x 0
+{
+    mat.myRows = 0;
+    mat.myCols = 0;
+}
+
+template <class itemType, class allocPolicy, class layout>
+matrix<itemType, allocPolicy, layout>::~matrix ()
 // postcondition: matrix is destroyed
 {
     // mlist destructor frees everything
 }
 
-template <class itemType>
-const matrix<itemType> &
-matrix<itemType>::operator = (const matrix<itemType> & rhs)
+template <class itemType, class allocPolicy, class layout>
+const matrix<itemType, allocPolicy, layout> &
+matrix<itemType, allocPolicy, layout>::operator = (const matrix<itemType, allocPolicy, layout> & rhs)
 // postcondition: normal assignment via copying has been performed
-//                (if matrix and rhs were different sizes, matrix has 
-//                been resized to match the size of rhs)     
+//                (if matrix and rhs were different sizes, matrix has
+//                been resized to match the size of rhs)
 {
     if (this != &rhs)                    // don't assign to self!
     {
-        myMatrix.resize(rhs.myRows);     // resize to proper # of rows
+        myMatrix = rhs.myMatrix;         // copies every row/item
         myRows = rhs.myRows;             // set dimensions
         myCols = rhs.myCols;
-        
-        // copy rhs
-        int k;
-        for(k=0; k < myRows; k++)
-        {
-	    myMatrix[k] = rhs.myMatrix[k];
-        }
     }
-    return *this;       
+    return *this;
 }
 
-template <class itemType>
-int matrix<itemType>::numRows() const
+template <class itemType, class allocPolicy, class layout>
+const matrix<itemType, allocPolicy, layout> &
+matrix<itemType, allocPolicy, layout>::operator = (matrix<itemType, allocPolicy, layout> && rhs) noexcept
+// postcondition: matrix has rhs's items and storage; rhs is 0 x 0
+{
+    if (this != &rhs)
+    {
+        matrix<itemType, allocPolicy, layout> old(std::move(rhs));
+        swap(old);                       // our old items die with old
+    }
+    return *this;
+}
+
+template <class itemType, class allocPolicy, class layout>
+void matrix<itemType, allocPolicy, layout>::swap(matrix<itemType, allocPolicy, layout> & mat) noexcept
+// postcondition: matrix and mat have exchanged sizes and items
+{
+    std::swap(myRows, mat.myRows);
+    std::swap(myCols, mat.myCols);
+    myMatrix.swap(mat.myMatrix);
+}
+
+template <class itemType, class allocPolicy, class layout>
+void swap(matrix<itemType, allocPolicy, layout> & a, matrix<itemType, allocPolicy, layout> & b) noexcept
+{
+    a.swap(b);
+}
+
+template <class itemType, class allocPolicy, class layout>
+int matrix<itemType, allocPolicy, layout>::numRows() const
 // postcondition: returns number of rows
 {
     return myRows;
 }
 
-template <class itemType>
-int matrix<itemType>::numCols() const
+template <class itemType, class allocPolicy, class layout>
+int matrix<itemType, allocPolicy, layout>::numCols() const
 // postcondition: returns number of columns
 {
     return myCols;
 }
 
+template <class itemType, class allocPolicy, class layout>
+itemType * matrix<itemType, allocPolicy, layout>::data()
+// precondition: layout is flatLayout
+// postcondition: returns the first item of the row-major buffer
+{
+    return myMatrix.data();
+}
 
-template <class itemType>
-void matrix<itemType>::resize(int newRows, int newCols)
+template <class itemType, class allocPolicy, class layout>
+const itemType * matrix<itemType, allocPolicy, layout>::data() const
+// precondition: layout is flatLayout
+// postcondition: returns the first item of the row-major buffer
+{
+    return myMatrix.data();
+}
+
+
+template <class itemType, class allocPolicy, class layout>
+void matrix<itemType, allocPolicy, layout>::resize(int newRows, int newCols)
 // precondition: matrix size is rows X cols,
 //               0 <= newRows and 0 <= newCols
 // postcondition: matrix size is newRows X newCols;
@@ -241,46 +481,51 @@ void matrix<itemType>::resize(int newRows, int newCols)
 //                      elements may be lost
 //
 {
-    int k;
-    myMatrix.resize(newRows);
-
-    for(k=0; k < newRows; k++)
-    {
-        myMatrix[k].resize(newCols);
-    }
+    myMatrix.resize(myRows, myCols, newRows, newCols);
     myRows = newRows;
     myCols = newCols;
 }
 
-template <class itemType>
-const mlist<itemType> &
-matrix<itemType>::operator [] (int k) const
+template <class itemType, class allocPolicy, class layout>
+typename matrix<itemType, allocPolicy, layout>::constRowType
+matrix<itemType, allocPolicy, layout>::operator [] (int k) const
 // precondition: 0 <= k < number of rows
 // postcondition: returns k-th row
 {
-	 if (k < 0 || myRows <= k)
-	 {
-		  cerr << "Illegal matrix index: " << k << " max index = ";
-		  cerr << (myRows-1) << endl;
-		  exit(1);
-	 }
-	 return myMatrix[k];
+	 checkIndex("Illegal matrix index: ", k, myRows);
+	 return myMatrix.row(k, myCols);
 }
 
-template <class itemType>
-mlist<itemType> &
-matrix<itemType>::operator [] (int k)
+template <class itemType, class allocPolicy, class layout>
+typename matrix<itemType, allocPolicy, layout>::rowType
+matrix<itemType, allocPolicy, layout>::operator [] (int k)
 // precondition: 0 <= k < number of rows
 // postcondition: returns k-th row
 {
-	 if (k < 0 || myRows <= k)
-	 {
-		  cerr << "Illegal matrix index: " << k << " max index = ";
-		  cerr << (myRows-1) << endl;
-        exit(1);
-    }    
-    return myMatrix[k];
-}
+    checkIndex("Illegal matrix index: ", k, myRows);
+    return myMatrix.row(k, myCols);
+}
+
+template <class itemType, class allocPolicy, class layout>
+itemType & matrix<itemType, allocPolicy, layout>::at(int row, int col)
+// postcondition: returns the item at (row, col)
+// exception: throws out_of_range unless both indices are in range
+{
+    checkIndexAt("Illegal matrix index: ", row, myRows);
+    checkIndexAt("Illegal matrix column index: ", col, myCols);
+    return myMatrix.row(row, myCols)[col];
+}
+
+template <class itemType, class allocPolicy, class layout>
+const itemType & matrix<itemType, allocPolicy, layout>::at(int row, int col) const
+// postcondition: returns the item at (row, col)
+// exception: throws out_of_range unless both indices are in range
+{
+    checkIndexAt("Illegal matrix index: ", row, myRows);
+    checkIndexAt("Illegal matrix column index: ", col, myCols);
+    return myMatrix.row(row, myCols)[col];
+}
 #endif
 
 
+
@@ -1,11 +1,15 @@
-
 #ifndef _MLIST_H
-#define _MLIST_H
-#define explicit
+#define _MLIST_H
+
+#include <new>
+#include <utility>
+#include "alloc.h"
+#include "indexing.h"
+#include "stathooks.h"
 
 using namespace std;
 
-template <class itemType>
+template <class itemType, class allocPolicy = heapAlloc>
 class mlist
 {
   public:
@@ -15,35 +19,59 @@ class mlist
 	 explicit mlist( int size );      // initial size of mlist is size
 	 mlist( int size, const itemType & fillValue ); // all entries == fillValue
 	 mlist( const mlist & vec );   // copy constructor
+	 mlist( mlist && vec ) noexcept;  // move constructor, steals vec's storage
 	 ~mlist( );                       // destructor
 
   // assignment
     const mlist & operator = ( const mlist & vec );
+    const mlist & operator = ( mlist && vec ) noexcept;
+    void swap( mlist & vec ) noexcept;      // exchange storage, no copying
 
   // accessors
-    int  size( ) const;                   // capacity of mlist
+    int  size( ) const;                   // number of items
+    int  capacity( ) const;               // items that fit without reallocating
 
   // indexing
-    itemType &       operator [ ] ( int index );       // indexing with range checking
-    const itemType & operator [ ] ( int index ) const; // indexing with range checking
+    itemType &       operator [ ] ( int index );       // checked per INDEX_CHECKS
+    const itemType & operator [ ] ( int index ) const; // checked per INDEX_CHECKS
+    itemType &       at( int index );                  // always checked, throws
+    const itemType & at( int index ) const;
 
   // modifiers
     void resize( int newSize );             // change size dynamically;
                                             // can result in losing values
+    void reserve( int newCapacity );        // room for newCapacity items
   private:
 
+    static itemType * allocate( int capacity ); // raw storage from allocPolicy
+    static void release( itemType * list, int size, int capacity );
+
     int  mySize;                            // # elements in array
+    int  myCapacity;                        // # elements storage can hold
     itemType * myList;                      // array used for storage
 };
 
+template <class itemType, class allocPolicy>
+void swap( mlist<itemType, allocPolicy> & a, mlist<itemType, allocPolicy> & b ) noexcept;
+
 // *******************************************************************
 //  Specifications for mlist functions
 //
 //  The template parameter itemType must satisfy the following two conditions:
 //   (1) itemType has a 0-argument constructor
-//   (2) operator = is defined for itemType
+//   (2) operator = and a copy constructor are defined for itemType
 //  Any violation of these conditions may result in compilation failure.
 //
+//  The template parameter allocPolicy (see alloc.h) supplies the raw
+//  storage; items are constructed in place and destroyed before the
+//  storage is handed back.  heapAlloc (the default) uses operator new,
+//  arenaAlloc and poolAlloc<BLOCK> avoid malloc in search code.
+//
+//  size() items are live; the storage holds capacity() >= size().  Growing
+//  past the capacity at least doubles it (like std::vector), so a run of
+//  resize(size() + 1) calls costs amortized O(1) each, and shrinking keeps
+//  the storage for later growth.
+//
 //  Any violation of a function's precondition will result in an error message
 //  followed by a call to exit.
 //
@@ -55,16 +83,19 @@ class mlist
 //
 //   mlist( int size )
 //     precondition: size >= 0
-//     postcondition: mlist has a capacity of size items
+//     postcondition: mlist has size default-constructed items
 //
 //   mlist( int size, const itemType & fillValue )
 //     precondition: size >= 0
-//     postcondition: mlist has a capacity of size items, all of which are set
-//                    by assignment to fillValue after default construction
+//     postcondition: mlist has size items, all of which are copies of
+//                    fillValue
 //
 //   mlist( const mlist & vec )
 //     postcondition: mlist is a copy of vec
 //
+//   mlist( mlist && vec ) noexcept
+//     postcondition: mlist has vec's items and storage; vec is empty
+//
 //   ~mlist( )
 //     postcondition: mlist is destroyed
 //
@@ -72,181 +103,347 @@ class mlist
 //
 //   const mlist & operator = ( const mlist & rhs )
 //     postcondition: normal assignment via copying has been performed;
-//                    if mlist and rhs were different sizes, mlist
-//                    has been resized to  match the size of rhs
+//                    storage is reused when it is big enough for rhs
+//
+//   const mlist & operator = ( mlist && rhs ) noexcept
+//     postcondition: mlist has rhs's items and storage, its old items are
+//                    destroyed; rhs is empty
+//
+//   void swap( mlist & vec ) noexcept
+//     postcondition: mlist and vec have exchanged items; nothing is copied
 //
-//  accessor
+//  accessors
 //
 //   int  size( ) const
-//     postcondition: returns mlist's size (number of memory cells
-//                    allocated for mlist)
+//     postcondition: returns mlist's size (number of items)
+//
+//   int  capacity( ) const
+//     postcondition: returns the number of items the current storage can
+//                    hold, capacity() >= size()
 //
 //  indexing
 //
 //   itemType &       operator [ ] ( int k )       -- index into nonconst mlist
 //   const itemType & operator [ ] ( int k ) const -- index into const mlist
-//     description: range-checked indexing, returning kth item
+//     description: indexing, returning kth item; the range check is
+//                  set by INDEX_CHECKS (see indexing.h)
 //     precondition: 0 <= k < size()
 //     postcondition: returns the kth item
 //
+//   itemType &       at( int k )                  -- index into nonconst mlist
+//   const itemType & at( int k ) const            -- index into const mlist
+//     description: range-checked indexing in every build
+//     postcondition: returns the kth item; throws out_of_range unless
+//                    0 <= k < size()
+//
 //  modifier
 //
 //   void resize( int newSize )
 //     description:  resizes the mlist to newSize elements
-//     precondition: the current capacity of mlist is size; newSize >= 0
+//     precondition: the current size of mlist is size; newSize >= 0
 //
-//     postcondition: the current capacity of mlist is newSize; for each k
+//     postcondition: the current size of mlist is newSize; for each k
 //                    such that 0 <= k <= min(size, newSize), mlist[k]
-//                    is a copy of the original; other elements of mlist are
-//                    initialized using the 0-argument itemType constructor
+//                    is the original item (moved if the storage grew);
+//                    other elements of mlist are initialized using the
+//                    0-argument itemType constructor
 //                    Note: if newSize < size, elements may be lost
 //
+//   void reserve( int newCapacity )
+//     precondition: newCapacity >= 0
+//     postcondition: capacity() >= newCapacity; size and items unchanged
+//
 //  examples of use
 //      mlist<int> v1;         // 0-element mlist
 //      mlist<int> v2(4);      // 4-element mlist
 //      mlist<int> v3(4, 22);  // 4-element mlist, all elements == 22.
-
-template <class itemType>
-mlist<itemType>::mlist()
+//      mlist<int, arenaAlloc> v4(4);   // storage from arena::current()
+//      mlist<int> v5(move(v3));        // v3's storage, no copying
+
+template <class itemType, class allocPolicy>
+mlist<itemType, allocPolicy>::mlist()
 //postcondition: mlist has a capacity of 0 items, and therefore it will
 //               need to be resized
     : mySize(0),
+      myCapacity(0),
       myList(0)
 {
 
 }
 
-template <class itemType>
-mlist<itemType>::mlist(int size)
+template <class itemType, class allocPolicy>
+mlist<itemType, allocPolicy>::mlist(int size)
 // precondition: size >= 0
-// postcondition: mlist has a capacity of size items
+// postcondition: mlist has size default-constructed items
    : mySize(size),
-     myList(new itemType[size])
+     myCapacity(size),
+     myList(allocate(size))
 {
-
+    int k;
+    for(k = 0; k < size; k++)
+    {
+        new (myList + k) itemType();
+    }
 }
 
-template <class itemType>
-mlist<itemType>::mlist(int size, const itemType & fillValue)
+template <class itemType, class allocPolicy>
+mlist<itemType, allocPolicy>::mlist(int size, const itemType & fillValue)
 // precondition: size >= 0
-// postcondition: mlist has a capacity of size items, all of which are set
-//                by assignment to fillValue after default construction
+// postcondition: mlist has size items, all of which are copies of
+//                fillValue
     : mySize(size),
-      myList(new itemType[size])
+      myCapacity(size),
+      myList(allocate(size))
 {
     int k;
     for(k = 0; k < size; k++)
     {
-        myList[k] = fillValue;
+        new (myList + k) itemType(fillValue);
     }
 }
 
-template <class itemType>
-mlist<itemType>::mlist(const mlist<itemType> & vec)
+template <class itemType, class allocPolicy>
+mlist<itemType, allocPolicy>::mlist(const mlist<itemType, allocPolicy> & vec)
 // postcondition: mlist is a copy of vec
     : mySize(vec.size()),
-      myList(new itemType[mySize])
+      myCapacity(vec.size()),
+      myList(allocate(mySize))
 {
     int k;
         // copy elements
     for(k = 0; k < mySize; k++){
-        myList[k] = vec.myList[k];
+        new (myList + k) itemType(vec.myList[k]);
     }
 }
 
-template <class itemType>
-mlist<itemType>::~mlist ()
+template <class itemType, class allocPolicy>
+mlist<itemType, allocPolicy>::mlist(mlist<itemType, allocPolicy> && vec) noexcept
+// postcondition: mlist has vec's items and storage; vec is empty
+    : mySize(vec.mySize),
+      myCapacity(vec.myCapacity),
+      myList(vec.myList)
+{
+    vec.mySize = 0;
+    vec.myCapacity = 0;
+    vec.myList = 0;
+}
+
+template <class itemType, class allocPolicy>
+mlist<itemType, allocPolicy>::~mlist ()
 // postcondition: mlist is destroyed
 {
-    delete [] myList;
+    release(myList, mySize, myCapacity);
 }
 
-template <class itemType>
-const mlist<itemType> &
-mlist<itemType>::operator = (const mlist<itemType> & rhs)
+template <class itemType, class allocPolicy>
+const mlist<itemType, allocPolicy> &
+mlist<itemType, allocPolicy>::operator = (const mlist<itemType, allocPolicy> & rhs)
 // postcondition: normal assignment via copying has been performed;
-//                if mlist and rhs were different sizes, mlist
-//                has been resized to  match the size of rhs
+//                storage is reused when it is big enough for rhs
 {
     if (this != &rhs)                           // don't assign to self!
     {
-        delete [] myList;                       // get rid of old storage
-        mySize = rhs.size();
-        myList = new itemType [mySize];         // allocate new storage
-
-            // copy rhs
         int k;
-        for(k=0; k < mySize; k++)
+        if(rhs.mySize > myCapacity)
+        {
+            itemType * newList = allocate(rhs.mySize);
+            for(k = 0; k < rhs.mySize; k++)
+            {
+                new (newList + k) itemType(rhs.myList[k]);
+            }
+            release(myList, mySize, myCapacity);  // get rid of old storage
+            myList = newList;
+            myCapacity = rhs.mySize;
+            mySize = rhs.mySize;
+            return *this;
+        }
+
+            // copy rhs into the storage we already have
+        int common = mySize < rhs.mySize ? mySize : rhs.mySize;
+        for(k = 0; k < common; k++)
         {
             myList[k] = rhs.myList[k];
         }
+        for(k = common; k < rhs.mySize; k++)
+        {
+            new (myList + k) itemType(rhs.myList[k]);
+        }
+        for(k = mySize - 1; k >= rhs.mySize; k--)
+        {
+            myList[k].~itemType();
+        }
+        mySize = rhs.mySize;
     }
     return *this;                               // permit a = b = c = d
 }
 
-template <class itemType>
-int mlist<itemType>::size() const
-// postcondition: returns mlist's size (number of memory cells
-//                allocated for mlist)
+template <class itemType, class allocPolicy>
+const mlist<itemType, allocPolicy> &
+mlist<itemType, allocPolicy>::operator = (mlist<itemType, allocPolicy> && rhs) noexcept
+// postcondition: mlist has rhs's items and storage, its old items are
+//                destroyed; rhs is empty
+{
+    if (this != &rhs)
+    {
+        release(myList, mySize, myCapacity);
+        mySize = rhs.mySize;
+        myCapacity = rhs.myCapacity;
+        myList = rhs.myList;
+        rhs.mySize = 0;
+        rhs.myCapacity = 0;
+        rhs.myList = 0;
+    }
+    return *this;
+}
+
+template <class itemType, class allocPolicy>
+void mlist<itemType, allocPolicy>::swap(mlist<itemType, allocPolicy> & vec) noexcept
+// postcondition: mlist and vec have exchanged items; nothing is copied
+{
+    std::swap(mySize, vec.mySize);
+    std::swap(myCapacity, vec.myCapacity);
+    std::swap(myList, vec.myList);
+}
+
+template <class itemType, class allocPolicy>
+void swap(mlist<itemType, allocPolicy> & a, mlist<itemType, allocPolicy> & b) noexcept
+{
+    a.swap(b);
+}
+
+template <class itemType, class allocPolicy>
+int mlist<itemType, allocPolicy>::size() const
+// postcondition: returns mlist's size (number of items)
 {
     return mySize;
 }
 
-template <class itemType>
-itemType & mlist<itemType>::operator [] (int k)
-// description: range-checked indexing, returning kth item
+template <class itemType, class allocPolicy>
+int mlist<itemType, allocPolicy>::capacity() const
+// postcondition: returns the number of items the storage can hold
+{
+    return myCapacity;
+}
+
+template <class itemType, class allocPolicy>
+itemType & mlist<itemType, allocPolicy>::operator [] (int k)
+// description: indexing, returning kth item
 // precondition: 0 <= k < size()
 // postcondition: returns the kth item
 {
-
-    if (k < 0 || mySize <= k)
-    {
-        cout << "Illegal mlist index: " << k << " max index = ";
-        cout << (mySize-1) << endl;
-        exit(1);
-    }
+    checkIndex("Illegal mlist index: ", k, mySize);
     return myList[k];
 }
 
-template <class itemType>
-const itemType & mlist<itemType>::operator [] (int k) const
+template <class itemType, class allocPolicy>
+const itemType & mlist<itemType, allocPolicy>::operator [] (int k) const
 // safe indexing, returning const reference to avoid modification
 // precondition: 0 <= index < size
 // postcondition: return index-th item
-// exception: aborts if index is out-of-bounds
+// exception: aborts if index is out-of-bounds (per INDEX_CHECKS)
 {
-    if (k < 0 || mySize <= k)
-    {
-        cerr << "Illegal mlist index: " << k << " max index = ";
-        cerr << (mySize-1) << endl;
-        exit(1);
-    }
+    checkIndex("Illegal mlist index: ", k, mySize);
 	 return myList[k];
 }
 
-template <class itemType>
-void mlist<itemType>::resize(int newSize)
+template <class itemType, class allocPolicy>
+itemType & mlist<itemType, allocPolicy>::at(int k)
+// postcondition: returns the kth item
+// exception: throws out_of_range unless 0 <= k < size()
+{
+    checkIndexAt("Illegal mlist index: ", k, mySize);
+    return myList[k];
+}
+
+template <class itemType, class allocPolicy>
+const itemType & mlist<itemType, allocPolicy>::at(int k) const
+// postcondition: returns the kth item
+// exception: throws out_of_range unless 0 <= k < size()
+{
+    checkIndexAt("Illegal mlist index: ", k, mySize);
+    return myList[k];
+}
+
+template <class itemType, class allocPolicy>
+void mlist<itemType, allocPolicy>::resize(int newSize)
 // description:  resizes the mlist to newSize elements
-// precondition: the current capacity of mlist is size(); newSize >= 0
-// postcondition: the current capacity of mlist is newSize; for each k
+// precondition: the current size of mlist is size(); newSize >= 0
+// postcondition: the current size of mlist is newSize; for each k
 //                such that 0 <= k <= min(size, newSize), mlist[k]
-//                is a copy of the original; other elements of mlist are
+//                is the original item; other elements of mlist are
 //                initialized using the 0-argument itemType constructor
 //                Note: if newSize < size, elements may be lost
 {
     int k;
-    int numToCopy = newSize < mySize ? newSize : mySize;
+    if(newSize > myCapacity)
+    {
+            // grow geometrically so repeated growth is amortized
+        reserve(newSize > 2 * myCapacity ? newSize : 2 * myCapacity);
+    }
+    for(k = mySize; k < newSize; k++)
+    {
+        new (myList + k) itemType();
+    }
+    for(k = mySize - 1; k >= newSize; k--)
+    {
+        myList[k].~itemType();             // storage is kept for regrowth
+    }
+    mySize = newSize;
+}
+
+template <class itemType, class allocPolicy>
+void mlist<itemType, allocPolicy>::reserve(int newCapacity)
+// precondition: newCapacity >= 0
+// postcondition: capacity() >= newCapacity; size and items unchanged
+{
+    if(newCapacity <= myCapacity)
+    {
+        return;
+    }
+    int k;
 
-         // allocate new storage and copy element into new storage
+         // allocate new storage and move items into it
 
-    itemType * newList = new itemType[newSize];
-    for(k=0; k < numToCopy; k++)
+    itemType * newList = allocate(newCapacity);
+    for(k=0; k < mySize; k++)
     {
-        newList[k] = myList[k];
+        new (newList + k) itemType(std::move(myList[k]));
     }
-    delete [] myList;                      // de-allocate old storage
-    mySize = newSize;                      // assign new storage/size
+    release(myList, mySize, myCapacity);   // de-allocate old storage
+    myCapacity = newCapacity;              // assign new storage/capacity
     myList = newList;
 }
 
+template <class itemType, class allocPolicy>
+itemType * mlist<itemType, allocPolicy>::allocate(int capacity)
+// precondition: capacity >= 0
+// postcondition: returns uninitialized storage from allocPolicy for
+//                capacity items (0 when capacity is 0)
+{
+    if(capacity <= 0)
+    {
+        return 0;
+    }
+    STAT_COUNT(STAT_MLIST_ALLOCS);
+    STAT_ADD(STAT_MLIST_BYTES, capacity * sizeof(itemType));
+    return (itemType *) allocPolicy::allocate(capacity * sizeof(itemType));
+}
+
+template <class itemType, class allocPolicy>
+void mlist<itemType, allocPolicy>::release(itemType * list, int size, int capacity)
+// postcondition: the first size items in list are destroyed and the
+//                storage for capacity items is returned to allocPolicy
+{
+    if(list == 0)
+    {
+        return;
+    }
+    int k;
+    for(k = size - 1; k >= 0; k--)
+    {
+        list[k].~itemType();
+    }
+    allocPolicy::deallocate(list, capacity * sizeof(itemType));
+}
+
 #endif
\ No newline at end of file
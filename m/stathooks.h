@@ -0,0 +1,53 @@
+#ifndef _STATHOOKS_H
+#define _STATHOOKS_H
+
+
+// the STAT_ hooks for the hot paths: move validation, win checks, move
+// input and mlist allocations.  This header has no includes of its own,
+// so anything may use the hooks for free.
+//
+// Build with -DINSTRUMENT=1 to turn them on; m/instrument.h is then
+// pulled in for what they record into.  By default every STAT_ macro
+// expands to an empty statement and nothing else is compiled.
+
+#ifndef INSTRUMENT
+#define INSTRUMENT 0
+#endif
+
+enum statCounter
+{
+    STAT_MOVES_CHECKED,                      // validMove calls
+    STAT_MOVES_REJECTED,                     // validMove said no
+    STAT_INPUT_RETRIES,                      // makeMove asked again
+    STAT_WIN_CHECKS,                         // checkWin / gameState::apply
+    STAT_MLIST_ALLOCS,                       // mlist storage allocations
+    STAT_MLIST_BYTES,                        // bytes they asked for
+    STAT_BOOK_HITS,                          // moves found in the opening book
+    STAT_CACHE_HITS,                         // moves found in the result cache
+    STAT_CACHE_MISSES,                       // moves not in the result cache
+    STAT_COUNTERS
+};
+
+enum statHistogram
+{
+    HIST_VALID_MOVE,                         // ns per validMove
+    HIST_WIN_CHECK,                          // ns per win check
+    HIST_MOVE_INPUT,                         // ns from prompt to valid move
+    STAT_HISTOGRAMS
+};
+
+#define STAT_JOIN2(a, b) a##b
+#define STAT_JOIN(a, b) STAT_JOIN2(a, b)
+
+#if INSTRUMENT
+#include "instrument.h"                      // what the hooks record into
+#define STAT_COUNT(c)   statThread().add(c, 1)
+#define STAT_ADD(c, n)  statThread().add(c, n)
+#define STAT_TIME(h)    statScope STAT_JOIN(statScope_, __LINE__)(h)
+#else
+#define STAT_COUNT(c)   do { } while(0)
+#define STAT_ADD(c, n)  do { } while(0)
+#define STAT_TIME(h)    do { } while(0)
+#endif
+
+#endif
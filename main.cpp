@@ -4,28 +4,73 @@
 
 #include <iostream>
 #include<vector>
+#include<cstdlib>
 #include "m/matrix.h"
+#include "game/bitboard.h"
+#include "game/winlines.h"
+#include "game/gamestate.h"
+#include "game/ultimate.h"
+#include "game/matrixrules.h"
+#include "game/solver.h"
+#include "game/mcts.h"
+#include "game/absearch.h"
+#include "game/outcomedb.h"
+#include "game/render.h"
+#include "game/record.h"
+#include "game/input.h"
+#include "game/book.h"
+#include "m/instrument.h"
 
 using namespace std;
 
 //what's initially in the board
 const char ORIG = ' '; 
 
-/*Loops over the game board.
-Displays the contents of each element.
+//precomputed 3 x 3 outcomes, loaded with --db (see tools/builddb.cpp)
+outcomeDb database;
+
+//formats each board into one reused buffer (--format picks the style)
+boardRenderer renderer;
+
+//finished games are appended here with --record (see tools/replay.cpp)
+recordWriter recorder;
+
+//writes the counters and timings to a file with --stats, when built
+//with -DINSTRUMENT=1 (see m/instrument.h)
+#if INSTRUMENT
+statReporter reporter;
+#endif
+
+//the computer's moves for common openings, loaded with --book (see
+//tools/buildbook.cpp), and the moves it has already searched this run,
+//at most --cache of them
+openingBook book;
+resultCache cache(4096);
+
+//the computer's moves that came from the outcome database, and the ones
+//that were searched for
+long long databaseMoves = 0;
+long long searches = 0;
+
+//the moves typed or piped in, after any given with --moves
+//(see game/input.h)
+moveReader input;
+
+//what makeMove returns when the input runs out mid-game
+const int NO_INPUT = -2;
+
+/*Displays the game board.
 Elements on same row have a | between them.
 Each row is on a new line.
 The board contains no horizontal lines
+The whole board is formatted first and written at once (see
+game/render.h); --format ansi colours the marks and --format fen prints
+one line per board.
 */
 void show(matrix<char>&board)
 {
-  for(int row = 0; row < board.numRows(); row++){
-    cout<<"|";
-    for(int col = 0; col < board.numCols(); col++){
-      cout<<board[row][col]<<"|";
-    }
-    cout<<endl;
-  }
+  renderer.render(board, ORIG);
+  renderer.write(cout);
 }
 
 /*Determines if the row(r) and column(c) are valid.
@@ -36,171 +81,584 @@ It should also make sure someone has not already played inside the element.
 
 bool validMove(matrix<char>&board, int r, int c)
 {
-  if(r < 0  || r > 2){//if the row is out of bounds
+  STAT_TIME(HIST_VALID_MOVE);
+  STAT_COUNT(STAT_MOVES_CHECKED);
+
+  if(r < 0  || r >= board.numRows()){//if the row is out of bounds
+    STAT_COUNT(STAT_MOVES_REJECTED);
     return false;
   }
-  if(c < 0 || c > 2){//if the column is out of bounds
+  if(c < 0 || c >= board.numCols()){//if the column is out of bounds
+    STAT_COUNT(STAT_MOVES_REJECTED);
     return false;
   }
 
   if(board[r][c] == 'o' || board[r][c] == 'x'){//if there is something in the spot already
+    STAT_COUNT(STAT_MOVES_REJECTED);
     return false;
   }
 
   return true;
 }
 
+/*Same check as above on the packed board (nkBoard::validMove checks
+the bounds, then the cell).
+*/
+template <int N, int K>
+bool validMove(const nkBoard<N,K>&pos, int r, int c)
+{
+  STAT_TIME(HIST_VALID_MOVE);
+  STAT_COUNT(STAT_MOVES_CHECKED);
+
+  if(!pos.validMove(r, c)){//if out of bounds or the spot is taken
+    STAT_COUNT(STAT_MOVES_REJECTED);
+    return false;
+  }
+  return true;
+}
+
+/*Reads the next move into row and column: two numbers typed (or piped)
+after prompt and "Column", or one cell (row * cols + col) from the
+--moves string, where a cell of -1 is a take back.  A row of -1 is
+returned at once without asking for the column.  Tokens that are not
+numbers are reported and skipped.
+Returns false when the input has run out.
+*/
+bool readMove(const string&prompt, int cols, int&row, int&column)
+{
+  bool scripted = input.scripted();
+  int *want[2] = {&row, &column};
+  for(int k = 0; k < 2; k++){
+    if(!scripted)
+      cout<<(k == 0 ? prompt : "Column (0-" + to_string(cols - 1) + "): ");
+    readStatus status;
+    while((status = input.next(*want[k])) == READ_BAD){
+      STAT_COUNT(STAT_INPUT_RETRIES);
+      cout<<"Not a number: "<<input.badToken()<<endl;
+    }
+    if(status == READ_END)
+      return false;
+    if(scripted){
+      //one cell stands for both
+      column = row < 0 ? 0 : row % cols;
+      row = row < 0 ? row : row / cols;
+      return true;
+    }
+    if(row == -1){
+      column = 0;
+      return true;
+    }
+  }
+  return true;
+}
+
 /*Asks the user for the row and column
 until a valid move has been specified.
 Calls validMove to verify this (and control a loop).
 Once a valid move is specified, marks the 
 board with the player's symbol, which is inside p
+Returns the cell that was played (row * columns + column), or NO_INPUT
+if the input ran out first.
 */
-void makeMove(matrix<char>&board, char p)
+int makeMove(matrix<char>&board, char p)
 {
+  STAT_TIME(HIST_MOVE_INPUT);
   int row, column;
+  bool valid;
 
   do{//keeps going if the player chooses wrong rows or columns
-    cout<<"Row (0-2): ";
-    cin>>row;
-
-    cout<<"Column (0-2): ";
-    cin>>column;
-
-  }while(validMove(board, row, column) == false);
+    if(!readMove("Row (0-" + to_string(board.numRows()-1) + "): ",
+                 board.numCols(), row, column))
+      return NO_INPUT;
+
+    valid = validMove(board, row, column);
+    if(!valid){
+      STAT_COUNT(STAT_INPUT_RETRIES);
+      cout<<"Can't play "<<row<<" "<<column<<endl;
+    }
+  }while(valid == false);
 
   //marks it once it has a valid move
   board[row][column] = p;
-
+  return row * board.numCols() + column;
 }
 
-/*Determines if the game is over.
-Checks for vertical, horizontal and diagonal wins.
-Also checks for the game ending in a draw (tie). If a tie is detected,
-Set moves equal to 99.
-Returns true when win has occurred or tie has occurred.
+/*Same as above for a game on the packed board.
+A row of -1 takes back the last move instead: nothing is marked and -1
+is returned.
+Returns the cell that was played, or NO_INPUT if the input ran out.
 */
-bool checkWin(const matrix<char>&board, char p, int &moves)
-{ 
-  int marks = 0;
-  //checks for vertical wins
-  for(int col = 0; col < board.numCols(); col++){
-    for(int row = 0; row < board.numRows(); row++){//goes through the entire column
-      if(board[row][col] == p){//if the current spot has players mark
-        marks = marks + 1; //adds to win
-      }
-    }
-    //after this column is checked for markings of the player
+template <int N, int K>
+int makeMove(gameState<N,K>&game)
+{
+  STAT_TIME(HIST_MOVE_INPUT);
+  int row, column;
+  bool valid;
 
-    if(marks == 3){//if all three spots were marked, player wins
-      return true;
-    }
-    else{//if all three spots were not marked by the player
-      marks = 0; //sets the wins to 0 again
+  do{//keeps going if the player chooses wrong rows or columns
+    if(!readMove("Row (0-" + to_string(N-1) +
+                 (game.numMoves() > 0 ? ", -1 takes back" : "") + "): ", N, row, column))
+      return NO_INPUT;
+    if(row == -1 && game.numMoves() > 0)
+      return -1;
+
+    valid = validMove(game.position(), row, column);
+    if(!valid){
+      STAT_COUNT(STAT_INPUT_RETRIES);
+      cout<<"Can't play "<<row<<" "<<column<<endl;
     }
-  }
+  }while(valid == false);
 
-  //checks for horizontal wins
-  for(int row = 0; row < board.numRows(); row++){
-    for(int col = 0; col < board.numCols(); col++){//goes through the entire row 
-      if(board[row][col] == p){//if the current spot has players mark
-        marks = marks + 1; //adds to win
-      }
-    }
-    //after this row is checked for markings of the player
+  //marks it once it has a valid move
+  int cell = nkBoard<N,K>::cellOf(row, column);
+  game.apply(cell);
+  return cell;
+}
 
-    if(marks == 3){//if all three spots were marked, player wins
-      return true;
-    }
-    else{//if all three spots were not marked by the player
-      marks = 0; //sets the wins to 0 again
-    }
-  }
+/*Takes back moves until it is a human player's turn again, so taking
+back against the computer also undoes the computer's reply.
+*/
+template <int N, int K>
+void takeBack(gameState<N,K>&game, const string&cpu)
+{
+  do{
+    game.undo();
+  }while(game.numMoves() > 0 && cpu.find(game.toMove()) != string::npos);
+}
 
-  //checks for diagnol wins
+/*Determines if the game is over after player p marked lastMove.
+Only the lines through lastMove can have changed, so only those are
+checked (see game/winlines.h).
+Returns X_WINS/O_WINS, DRAW when the board is full, or ONGOING.
+*/
+template <int N, int K>
+gameResult checkWin(const nkBoard<N,K>&pos, int lastMove, char p)
+{
+  STAT_TIME(HIST_WIN_CHECK);
+  STAT_COUNT(STAT_WIN_CHECKS);
+  return resultAfter(pos, lastMove, p);
+}
 
-  for(int x = 0; x < 3; x++){//top left to bottom right diagnol check
-    if(board[x][x] == p){
-      marks = marks + 1;
-    }
-  }
-  if(marks == 3){//if all three spots were marked, player wins
-      return true;
-    }
-  else{//if all three spots were not marked by the player
-      marks = 0; //sets the wins to 0 again
-  }
+/*Same as above for a board size with no packed version.
+Scans outward from lastMove for K in a row (see game/matrixrules.h).
+*/
+gameResult checkWin(const matrix<char>&board, const matrixRules<char>&rules,
+                    int lastMove, int moves)
+{
+  STAT_TIME(HIST_WIN_CHECK);
+  STAT_COUNT(STAT_WIN_CHECKS);
+  return rules.resultAfter(board, lastMove / board.numCols(),
+                           lastMove % board.numCols(), moves);
+}
 
-  int row = 0;
-  int col = 2;
-  for(int x = 0; x < 3; x++){//top right to bottom left diagnol check
-    if(board[row][col] == p){
-      marks = marks + 1;
-    }
-    row = row + 1;//goes down one row;
-    col = col - 1;//goes back one column
-  }
-  if(marks == 3){//if all three spots were marked, player wins
-      return true;
+/*Returns the computer's move for the side to move: the perfect-play
+move from a solver, or the most promising one from an mcts or
+alpha-beta search.  searched is set to true, since it ran one.
+*/
+template <class brainType, int N, int K>
+int pickMove(brainType&brain, const nkBoard<N,K>&pos, bool&searched)
+{
+  searched = true;
+  return brain.bestMove(pos);
+}
+
+/*Same as above for 3 x 3: one lookup in the outcome database when one
+is loaded, so no search is run (and searched is false).
+*/
+int pickMove(solver<3,3>&brain, const bitboard&pos, bool&searched)
+{
+  searched = !database.isOpen();
+  if(database.isOpen())
+    return database.bestMove(pos);
+  return brain.bestMove(pos);
+}
+
+/*Picks the move for the computer player to move and makes it: the
+opening book's move if it has the position, else one searched before
+(in any orientation) from the cache, else pickMove's.  Only moves that
+pickMove had to search for are cached and counted in searches.
+Returns the cell that was played.
+*/
+template <class brainType, int N, int K>
+int computerMove(brainType&brain, gameState<N,K>&game)
+{
+  const nkBoard<N,K>&pos = game.position();
+  int cell;
+  if(!book.find(pos, cell) && !cache.find(pos, cell)){
+    bool searched;
+    cell = pickMove(brain, pos, searched);
+    if(searched){
+      cache.store(pos, cell);
+      searches++;
     }
-  else{//if all three spots were not marked by the player
-      marks = 0; //sets the wins to 0 again
+    else
+      databaseMoves++;
   }
+  cout<<"Computer ("<<game.toMove()<<") plays "<<nkBoard<N,K>::rowOf(cell)<<" "
+      <<nkBoard<N,K>::colOf(cell)<<endl;
+  game.apply(cell);
+  return cell;
+}
 
-  //if non of the checks go through
-  if(moves == 9){//checks if all the spots are filled and no winners
-    moves = 99;
-    return true;
+/*Prints the result of a finished game.
+*/
+void showResult(gameResult result)
+{
+  //tie game - no one wins
+	if(result==DRAW)
+		cout<<"Draw"; 
+	else
+  {
+    //current player wins
+		cout<<"Player: "<<(result==X_WINS ? 'x' : 'o')<<" Wins!"; 
   }
-
-  //if goes through EVERYTHING returns false
-  return false;
 }
 
+/*Plays one game on a packed N x N board, K in a row wins.
+cpu lists the players the computer moves for ("", "x", "o" or "xo");
+brain picks their moves (a solver, an mcts or an alpha-beta player).
+Returns ONGOING, and records nothing, if the input ran out.
+*/
+template <int N, int K, class brainType>
+gameResult playPacked(const string&cpu, brainType&brain)
+{
+  //ORIG is a constant for the character marking empty spots on the board
+	matrix<char>brd(N,N,ORIG);
 
+  //the packed board, whose turn it is, the moves so far (for take
+  //backs and the game record) and how the game stands
+  gameState<N,K> game;
 
-int main()
-{
+	do{
 
-  //ORIG is a constant for the character marking empty spots on the board
-	matrix<char>brd(3,3,ORIG);
+    //draw the board
+		show(brd); 
+
+    //work through the move of the player whose turn it is
+		int cell; 
+		if(cpu.find(game.toMove())!=string::npos)
+			cell=computerMove(brain,game); 
+		else
+			cell=makeMove(game); 
+		if(cell==NO_INPUT)
+			return ONGOING;
+		if(cell<0)
+			takeBack(game,cpu);
+		game.position().toMatrix(brd, ORIG);
+
+  //the game keeps its own result up to date
+	}while(game.result()==ONGOING); 
+
+  if(recorder.isOpen())
+    recorder.write(N, K, game.moves(), game.numMoves(), game.result());
+	return game.result();
+}
 
+/*Plays one game on a size x size matrix, run in a row wins.
+Used for sizes that have no packed board.
+Returns ONGOING if the input ran out.
+*/
+gameResult playMatrix(int size, int run)
+{
+	matrix<char>brd(size,size,ORIG);
+  matrixRules<char> rules(size, run, ORIG, 'x');
 
-  //symbol representing current player
   char player='o'; 
-
-  //total number of moves made so far (9 moves without a win means a tie)
 	int moves=0; 
+	gameResult result=ONGOING; 
+  vector<uint8_t> cells;
 
 	do{
-
-    //count the move
-		moves++; 
-
-    //toggle between players so turns alternate
 		if(player=='x') 
 			player='o';
 		else
 			player='x';
 
-    //draw the board
 		show(brd); 
+		int cell=makeMove(brd,player); 
+		if(cell==NO_INPUT)
+			return ONGOING;
+		moves++; 
+		cells.push_back((uint8_t) cell);
+		result=checkWin(brd,rules,cell,moves); 
+	}while(result==ONGOING); 
 
-    //work through player's move
-		makeMove(brd,player); 
+  if(recorder.isOpen())
+    recorder.write(size, run, &cells[0], moves, result);
+	return result;
+}
 
-  //see if the game is over
-	}while(!checkWin(brd,player, moves)); 
+/*Asks for a move on the ultimate grid until a legal one is given.
+validMove checks the cell the same way as on a single board, then the
+game checks it is in a small board that may be played now.
+Returns the move (row * 9 + column), or NO_INPUT if the input ran out.
+*/
+int makeMove(ultimateBoard&game, matrix<char>&board)
+{
+  STAT_TIME(HIST_MOVE_INPUT);
+  int row, column;
+  bool valid;
 
-  //tie game - no one wins
-	if(moves==99)
-		cout<<"Draw"; 
-	else
-  {
-    //current player wins
-		cout<<"Player: "<<player<<" Wins!"; 
+  do{//keeps going if the player chooses wrong rows or columns
+    if(game.forced() != ultimateBoard::ANY && !input.scripted())
+      cout<<"Play in board "<<game.forced()/3<<" "<<game.forced()%3<<endl;
+
+    if(!readMove("Row (0-8): ", ultimateBoard::SIZE, row, column))
+      return NO_INPUT;
+
+    valid = validMove(board, row, column) &&
+            game.isLegal(ultimateBoard::moveOf(row, column));
+    if(!valid){
+      STAT_COUNT(STAT_INPUT_RETRIES);
+      cout<<"Can't play "<<row<<" "<<column<<endl;
+    }
+  }while(valid == false);
+
+  int move = ultimateBoard::moveOf(row, column);
+  game.apply(move);
+  return move;
+}
+
+/*Plays one game of ultimate tic-tac-toe (see game/ultimate.h) for two
+players, shown as one 9 x 9 board.
+Returns ONGOING if the input ran out.
+*/
+gameResult playUltimate()
+{
+	matrix<char>brd(ultimateBoard::SIZE,ultimateBoard::SIZE,ORIG);
+  ultimateBoard game;
+
+	do{
+		show(brd); 
+		if(makeMove(game,brd)==NO_INPUT)
+			return ONGOING;
+		game.toMatrix(brd, ORIG);
+	}while(game.result()==ONGOING); 
+
+	show(brd); 
+	return game.result();
+}
+
+/*Usage: main [size [run]] [--cpu x|o|xo] [--db file]
+             [--time ms] [--iterations n] [--threads t]
+             [--search mcts|ab] [--depth d] [--format compact|ansi|fen]
+             [--record file] [--ultimate] [--moves 4,0,8]
+             [--book file] [--cache n]
+             [--stats file] [--stats-every ms]
+Defaults to the classic 3 x 3 game.  3x3, 4x4, 5x5 with 4 in a row and
+15x15 with 5 in a row (gomoku) use packed boards; any other size falls
+back to the matrix rules.  --cpu lets the computer play for x, o or
+both: up to 4 x 4 the solver plays perfectly, on bigger boards Monte
+Carlo tree search thinks for --time ms (default 1000) or --iterations
+playouts on --threads cores (default all).  --search ab plays parallel
+alpha-beta instead, searching deeper until --time runs out or it is
+--depth moves deep.  --db loads the 3 x 3 outcome database built by
+tools/builddb so those moves need no search.  --record appends the
+finished game to a game record file (boards up to 15 x 15) that
+tools/replay can check.  --ultimate plays ultimate tic-tac-toe instead,
+two players on nine 3 x 3 boards.  --moves plays the human moves it
+lists (cells, row * size + col, -1 to take back) before reading any
+more from stdin; stdin is read in blocks, so a whole game can be piped
+in, and the program stops when it runs out mid-game.  --book loads an
+opening book built by tools/buildbook for the same board, whose moves
+the computer plays without searching; positions it does search are
+kept in a cache of --cache n entries (default 4096, least recently
+used dropped first), so take backs don't search again.  --stats
+rewrites file every --stats-every ms (default 1000) with the move
+validation, win check, input and allocation counters: JSON if the name
+ends in .json, Prometheus text otherwise.  It needs -DINSTRUMENT=1.
+*/
+int main(int argc, char *argv[])
+{
+  int size = 3;
+  int run = 0;
+  string cpu;
+  int numbers = 0;
+  bool ultimate = false;
+  string statsPath;
+  int statsEvery = 1000;
+  string search = "mcts";
+  int depth = 0;
+
+  //cout buffers on its own; input flushes it before each read so
+  //prompts still show
+  ios::sync_with_stdio(false);
+  input.tie(&cout);
+
+  //the mcts player's budget, by default 1 second per move on every core
+  mctsLimits limits;
+  limits.iterations = 0;
+  limits.threads = 0;
+
+  for(int k = 1; k < argc; k++){
+    string arg = argv[k];
+    if(arg == "--cpu" && k + 1 < argc)
+      cpu = argv[++k];
+    else if(arg == "--time" && k + 1 < argc)
+      limits.milliseconds = atoi(argv[++k]);
+    else if(arg == "--iterations" && k + 1 < argc)
+      limits.iterations = atoll(argv[++k]);
+    else if(arg == "--threads" && k + 1 < argc)
+      limits.threads = atoi(argv[++k]);
+    else if(arg == "--search" && k + 1 < argc)
+      search = argv[++k];
+    else if(arg == "--depth" && k + 1 < argc)
+      depth = atoi(argv[++k]);
+    else if(arg == "--format" && k + 1 < argc){
+      renderFormat format;
+      if(!boardRenderer::parseFormat(argv[++k], format)){
+        cerr<<"Unknown format "<<argv[k]<<"; use compact, ansi or fen"<<endl;
+        return 1;
+      }
+      renderer.setFormat(format);
+    }
+    else if(arg == "--record" && k + 1 < argc){
+      if(!recorder.open(argv[++k])){
+        cerr<<"Can't append to the game record "<<argv[k]<<endl;
+        return 1;
+      }
+    }
+    else if(arg == "--ultimate")
+      ultimate = true;
+    else if(arg == "--moves" && k + 1 < argc)
+      input.script(argv[++k]);
+    else if(arg == "--book" && k + 1 < argc){
+      if(!book.open(argv[++k])){
+        cerr<<"Can't load the opening book "<<argv[k]<<endl;
+        return 1;
+      }
+    }
+    else if(arg == "--cache" && k + 1 < argc){
+      int entries = atoi(argv[++k]);
+      if(entries < 0){
+        cerr<<"--cache needs a count of 0 or more"<<endl;
+        return 1;
+      }
+      cache.setCapacity(entries);
+    }
+    else if(arg == "--stats" && k + 1 < argc)
+      statsPath = argv[++k];
+    else if(arg == "--stats-every" && k + 1 < argc)
+      statsEvery = atoi(argv[++k]);
+    else if(arg == "--db" && k + 1 < argc){
+      if(!database.open(argv[++k])){
+        cerr<<"Can't load the outcome database "<<argv[k]<<endl;
+        return 1;
+      }
+    }
+    else{
+      if(numbers == 0)
+        size = atoi(argv[k]);
+      else if(numbers == 1)
+        run = atoi(argv[k]);
+      numbers++;
+    }
+  }
+  if(run == 0)
+    run = size;
+
+  if(size < 1 || run < 1 || run > size ||
+     cpu.find_first_not_of("xo") != string::npos ||
+     limits.iterations < 0 || limits.milliseconds < 0 || limits.threads < 0 ||
+     (search != "mcts" && search != "ab") || depth < 0 || statsEvery < 1){
+    cerr<<"Usage: "<<argv[0]<<" [size [run]] [--cpu x|o|xo] [--db file]"
+        <<" [--time ms] [--iterations n] [--threads t] [--search mcts|ab] [--depth d]"
+        <<" [--format compact|ansi|fen]"
+        <<" [--record file] [--ultimate] [--moves 4,0,8] [--book file] [--cache n]"
+        <<" [--stats file] [--stats-every ms]"
+        <<" with 1 <= run <= size"<<endl;
+    return 1;
+  }
+  if(database.isOpen() && (size != 3 || run != 3)){
+    cerr<<"The outcome database is for 3 x 3, 3 in a row"<<endl;
+    return 1;
+  }
+  if(book.boardSize() != 0 && (book.boardSize() != size || book.run() != run)){
+    cerr<<"The opening book is for "<<book.boardSize()<<" x "<<book.boardSize()
+        <<", "<<book.run()<<" in a row"<<endl;
+    return 1;
+  }
+  if(recorder.isOpen() && size > REC_MAX_SIZE){
+    cerr<<"Game records hold boards up to "<<REC_MAX_SIZE<<" x "<<REC_MAX_SIZE<<endl;
+    return 1;
+  }
+  if(!statsPath.empty()){
+#if INSTRUMENT
+    if(!reporter.start(statsPath, statsEvery)){
+      cerr<<"Can't write statistics to "<<statsPath<<endl;
+      return 1;
+    }
+#else
+    cerr<<"--stats needs a build with -DINSTRUMENT=1"<<endl;
+    return 1;
+#endif
+  }
+  //alpha-beta stops at --time or --depth, by default after 1 second
+  searchLimits abLimits;
+  abLimits.milliseconds = limits.milliseconds;
+  abLimits.depth = depth;
+  abLimits.threads = limits.threads;
+  if(abLimits.milliseconds == 0 && depth == 0)
+    abLimits.milliseconds = 1000;
+  if(limits.iterations == 0 && limits.milliseconds == 0)
+    limits.milliseconds = 1000;
+  if(cpu.empty())
+    limits.threads = abLimits.threads = 1;
+
+  gameResult result;
+  if(ultimate){
+    if(!cpu.empty() || recorder.isOpen()){
+      cerr<<"Ultimate tic-tac-toe is for two players and is not recorded"<<endl;
+      return 1;
+    }
+    result = playUltimate();
+  }
+  else if(size == 3 && run == 3){
+    solver<3,3> brain(cpu.empty() ? 0 : 14);
+    result = playPacked<3,3>(cpu, brain);
+  }
+  else if(size == 4 && run == 4){
+    solver<4,4> brain(cpu.empty() ? 0 : 22);
+    result = playPacked<4,4>(cpu, brain);
+  }
+  else if(size == 5 && run == 4 && search == "ab"){
+    abSearch<5,4> brain(abLimits);
+    result = playPacked<5,4>(cpu, brain);
+  }
+  else if(size == 15 && run == 5 && search == "ab"){
+    abSearch<15,5> brain(abLimits);
+    result = playPacked<15,5>(cpu, brain);
+  }
+  else if(size == 5 && run == 4){
+    mcts<5,4> brain(limits);
+    result = playPacked<5,4>(cpu, brain);
+  }
+  else if(size == 15 && run == 5){
+    mcts<15,5> brain(limits);
+    result = playPacked<15,5>(cpu, brain);
+  }
+  else if(cpu.empty())
+    result = playMatrix(size, run);
+  else{
+    cerr<<"The computer player needs one of the packed sizes: 3 3, 4 4, 5 4 or 15 5"<<endl;
+    return 1;
   }
 
-	return 0;
+  if(result==ONGOING){
+    cout<<endl;
+    cerr<<"The input ended before the game did"<<endl;
+  }
+  else{
+    showResult(result);
+    cout<<endl;
+  }
+  if(!cpu.empty())
+    cout<<"Book moves: "<<book.hits()<<", database: "<<databaseMoves
+        <<", cached: "<<cache.hits()<<", searched: "<<searches<<endl;
+#if INSTRUMENT
+  reporter.stop();
+#endif
+
+	return result==ONGOING ? 1 : 0;
 }
 
@@ -0,0 +1,515 @@
+//Microbenchmarks for the containers and the game logic.
+//Prints one JSON object per line: ns per operation, operator new calls
+//per operation and operations (or games) per second.
+//Usage: bench [--filter text] [--time ms]
+//Build the same way as the program being measured, e.g. with
+//-DINDEX_CHECKS=0 or -mavx2, to compare build modes.
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+#include "../m/matrix.h"
+#include "../game/matrixrules.h"
+#include "../game/batchwin.h"
+#include "../game/solver.h"
+#include "../game/rng.h"
+#include "../game/render.h"
+#include "../game/ultimate.h"
+#include "../game/threats.h"
+#include "../game/book.h"
+
+using namespace std;
+
+//operator new calls so far, counted by the replacements below
+long long allocations = 0;
+
+void * operator new(size_t bytes)
+{
+  allocations++;
+  void *p = malloc(bytes > 0 ? bytes : 1);
+  if(p == 0)
+    throw bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+  free(p);
+}
+
+//only benchmarks whose name contains this run
+string filter;
+
+//how long each benchmark is timed for
+double minSeconds = 0.2;
+
+/*Stops the compiler from optimizing away the work that produced v.
+*/
+template <class T>
+void keep(const T&v)
+{
+  asm volatile("" : : "g"(&v) : "memory");
+}
+
+/*Times body, doubling the repetitions until a run takes minSeconds,
+and prints the last run as a JSON line.
+*/
+template <class F>
+void bench(const string&name, F body)
+{
+  if(name.find(filter) == string::npos)
+    return;
+
+  long long reps = 1;
+  double seconds = 0;
+  long long allocs = 0;
+  for(;;){
+    long long before = allocations;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(long long k = 0; k < reps; k++)
+      body();
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    allocs = allocations - before;
+    if(seconds >= minSeconds || reps >= (1LL << 40))
+      break;
+    reps *= 2;
+  }
+
+  cout<<"{\"name\":\""<<name<<"\",\"reps\":"<<reps
+      <<",\"ns_per_op\":"<<seconds * 1e9 / reps
+      <<",\"allocs_per_op\":"<<(double) allocs / reps
+      <<",\"ops_per_sec\":"<<reps / (seconds > 0 ? seconds : 1e-9)
+      <<",\"index_checks\":"<<INDEX_CHECKS
+      <<",\"simd_width\":"<<boardBatch<3,3>::width()<<"}"<<endl;
+}
+
+//positions for the win checks: a board, the cell just marked and who
+//marked it, all taken from random games
+const int POSITIONS = 1024;
+
+template <int N, int K>
+struct sample
+{
+  nkBoard<N,K> pos;
+  int cell;
+  char player;
+  int moves;
+};
+
+/*Returns a random open cell of pos.
+*/
+template <int N, int K>
+int randomOpen(const nkBoard<N,K>&pos, fastRng&rng)
+{
+  int cell;
+  do{
+    cell = rng.below(N * N);
+  }while(!pos.isOpen(cell));
+  return cell;
+}
+
+/*Fills samples with random positions reached by random play.
+*/
+template <int N, int K>
+void makeSamples(sample<N,K> *samples, fastRng&rng)
+{
+  for(int k = 0; k < POSITIONS; k++){
+    nkBoard<N,K> pos;
+    char player = 'x';
+    int stop = 1 + rng.below(N * N);
+    int moves = 0, cell = 0;
+    gameResult result = ONGOING;
+    while(result == ONGOING && moves < stop){
+      cell = randomOpen<N,K>(pos, rng);
+      pos.apply(cell, player);
+      result = resultAfter(pos, cell, player);
+      moves++;
+      player = (player == 'x') ? 'o' : 'x';
+    }
+    samples[k].pos = pos;
+    samples[k].cell = cell;
+    samples[k].player = (player == 'x') ? 'o' : 'x';
+    samples[k].moves = moves;
+  }
+}
+
+/*Plays one random game on a packed board.
+*/
+template <int N, int K>
+gameResult randomGame(fastRng&rng)
+{
+  nkBoard<N,K> pos;
+  int open[N * N];
+  int numOpen = N * N;
+  for(int k = 0; k < numOpen; k++)
+    open[k] = k;
+
+  char player = 'x';
+  gameResult result = ONGOING;
+  while(result == ONGOING){
+    int k = rng.below(numOpen);
+    int cell = open[k];
+    open[k] = open[--numOpen];
+    pos.apply(cell, player);
+    result = resultAfter(pos, cell, player);
+    player = (player == 'x') ? 'o' : 'x';
+  }
+  return result;
+}
+
+/*Plays one random game on a matrix with the matrix rules, the way the
+original program did: pick a cell, check it with validMove, mark it.
+*/
+gameResult randomMatrixGame(int size, int run, fastRng&rng)
+{
+  matrix<char> board(size, size, ' ');
+  matrixRules<char> rules(size, run, ' ', 'x');
+  char player = 'x';
+  int moves = 0;
+  gameResult result = ONGOING;
+  while(result == ONGOING){
+    int r, c;
+    do{
+      r = rng.below(size);
+      c = rng.below(size);
+    }while(!rules.validMove(board, r, c));
+    board[r][c] = player;
+    moves++;
+    result = rules.resultAfter(board, r, c, moves);
+    player = (player == 'x') ? 'o' : 'x';
+  }
+  return result;
+}
+
+/*The original program's win check, kept as the baseline: scans every
+column, row and diagonal of a 3 x 3 board for three of p, and calls a
+full board after 9 moves a tie (moves becomes 99).
+*/
+bool fullScanCheckWin(const matrix<char>&board, char p, int &moves)
+{
+  int marks = 0;
+  for(int col = 0; col < board.numCols(); col++){
+    for(int row = 0; row < board.numRows(); row++)
+      if(board[row][col] == p)
+        marks = marks + 1;
+    if(marks == 3)
+      return true;
+    marks = 0;
+  }
+  for(int row = 0; row < board.numRows(); row++){
+    for(int col = 0; col < board.numCols(); col++)
+      if(board[row][col] == p)
+        marks = marks + 1;
+    if(marks == 3)
+      return true;
+    marks = 0;
+  }
+  for(int x = 0; x < 3; x++)
+    if(board[x][x] == p)
+      marks = marks + 1;
+  if(marks == 3)
+    return true;
+  marks = 0;
+  for(int x = 0; x < 3; x++)
+    if(board[x][2 - x] == p)
+      marks = marks + 1;
+  if(marks == 3)
+    return true;
+  if(moves == 9){
+    moves = 99;
+    return true;
+  }
+  return false;
+}
+
+/*The original program's move check, the baseline for validMove.
+*/
+bool fullScanValidMove(matrix<char>&board, int r, int c)
+{
+  if(r < 0 || r > 2)
+    return false;
+  if(c < 0 || c > 2)
+    return false;
+  if(board[r][c] == 'o' || board[r][c] == 'x')
+    return false;
+  return true;
+}
+
+/*Copies the board at every node of the game tree below it, depth moves
+deep, the way a search on matrix boards does.
+Returns the number of nodes.
+*/
+template <class matrixType>
+long long cloneTree(const matrixType&board, char player, int depth)
+{
+  if(depth == 0)
+    return 1;
+  long long nodes = 1;
+  for(int r = 0; r < board.numRows(); r++)
+    for(int c = 0; c < board.numCols(); c++)
+      if(board[r][c] == ' '){
+        matrixType child(board);
+        child[r][c] = player;
+        nodes += cloneTree(child, player == 'x' ? 'o' : 'x', depth - 1);
+      }
+  return nodes;
+}
+
+/*matrix construction, copy, assignment, move and resize for one
+storage layout.
+*/
+template <class matrixType>
+void matrixBenches(const string&layout)
+{
+  matrixType src(3, 3, 'x');
+  matrixType dst(3, 3, ' ');
+  matrixType grow(3, 3, ' ');
+  matrixType spare(3, 3, ' ');
+
+  bench("matrix.construct3x3/" + layout, [&](){
+    matrixType m(3, 3, ' ');
+    keep(m);
+  });
+  bench("matrix.construct15x15/" + layout, [&](){
+    matrixType m(15, 15, ' ');
+    keep(m);
+  });
+  bench("matrix.copy3x3/" + layout, [&](){
+    matrixType m(src);
+    keep(m);
+  });
+  bench("matrix.assign3x3/" + layout, [&](){
+    dst = src;
+    keep(dst);
+  });
+  bench("matrix.move3x3/" + layout, [&](){
+    matrixType m(std::move(spare));
+    spare = std::move(m);
+    keep(spare);
+  });
+  bench("matrix.resize3x3to4x4/" + layout, [&](){
+    grow.resize(4, 4);
+    grow.resize(3, 3);
+    keep(grow);
+  });
+  bench("matrix.scan3x3/" + layout, [&](){
+    int marks = 0;
+    for(int r = 0; r < 3; r++)
+      for(int c = 0; c < 3; c++)
+        marks += src[r][c] != ' ';
+    keep(marks);
+  });
+}
+
+int main(int argc, char *argv[])
+{
+  for(int k = 1; k < argc; k++){
+    string arg = argv[k];
+    if(arg == "--filter" && k + 1 < argc)
+      filter = argv[++k];
+    else if(arg == "--time" && k + 1 < argc)
+      minSeconds = atoi(argv[++k]) / 1000.0;
+    else{
+      cerr<<"Usage: "<<argv[0]<<" [--filter text] [--time ms]"<<endl;
+      return 1;
+    }
+  }
+
+  fastRng rng(1);
+
+  //containers
+  matrixBenches<matrix<char> >("flat");
+  matrixBenches<matrix<char, heapAlloc, rowLayout> >("row");
+  matrixBenches<matrix<char, poolAlloc<64> > >("flat-pool");
+  matrixBenches<matrix<char, poolAlloc<64>, rowLayout> >("row-pool");
+
+  //a 3-move search that clones the board at each of its 586 nodes; the
+  //arena is reset after every search
+  bench("search.clone3x3/heap", [&](){
+    matrix<char> board(3, 3, ' ');
+    long long nodes = cloneTree(board, 'x', 3);
+    keep(nodes);
+  });
+  bench("search.clone3x3/pool", [&](){
+    matrix<char, poolAlloc<64> > board(3, 3, ' ');
+    long long nodes = cloneTree(board, 'x', 3);
+    keep(nodes);
+  });
+  arena scratch(1 << 16);
+  bench("search.clone3x3/arena", [&](){
+    {
+      arenaScope use(scratch);
+      matrix<char, arenaAlloc> board(3, 3, ' ');
+      long long nodes = cloneTree(board, 'x', 3);
+      keep(nodes);
+    }
+    scratch.reset();
+  });
+
+  mlist<int> numbers(1024, 1);
+  bench("mlist.index1024", [&](){
+    int sum = 0;
+    for(int k = 0; k < numbers.size(); k++)
+      sum += numbers[k];
+    keep(sum);
+  });
+  bench("mlist.grow1024", [&](){
+    mlist<int> list;
+    for(int k = 0; k < 1024; k++)
+      list.resize(k + 1);
+    keep(list);
+  });
+
+  //win checks on the same random positions, packed and as matrices
+  static sample<3,3> small[POSITIONS];
+  static sample<15,5> large[POSITIONS];
+  makeSamples(small, rng);
+  makeSamples(large, rng);
+
+  static matrix<char> smallBoards[POSITIONS];
+  for(int k = 0; k < POSITIONS; k++){
+    smallBoards[k].resize(3, 3);
+    small[k].pos.toMatrix(smallBoards[k], ' ');
+  }
+  matrixRules<char> rules3(3, 3, ' ', 'x');
+
+  int next = 0;
+  bench("checkWin/fullscan3x3", [&](){
+    int k = next++ & (POSITIONS - 1);
+    int moves = small[k].moves;
+    bool over = fullScanCheckWin(smallBoards[k], small[k].player, moves);
+    keep(over);
+  });
+  bench("checkWin/packed3x3", [&](){
+    const sample<3,3>&s = small[next++ & (POSITIONS - 1)];
+    gameResult result = resultAfter(s.pos, s.cell, s.player);
+    keep(result);
+  });
+  bench("checkWin/matrix3x3", [&](){//what main.cpp's matrix checkWin calls
+    int k = next++ & (POSITIONS - 1);
+    const sample<3,3>&s = small[k];
+    gameResult result = rules3.resultAfter(smallBoards[k], s.cell / 3, s.cell % 3, s.moves);
+    keep(result);
+  });
+  bench("checkWin/packed15x15", [&](){
+    const sample<15,5>&s = large[next++ & (POSITIONS - 1)];
+    gameResult result = resultAfter(s.pos, s.cell, s.player);
+    keep(result);
+  });
+
+  boardBatch<3,3> batch;
+  for(int k = 0; k < POSITIONS; k++)
+    batch.add(small[k].pos);
+  static gameResult results[POSITIONS];
+  bench("checkWin/batch3x3x1024", [&](){
+    batch.results(results);
+    keep(results);
+  });
+
+  //rows and columns from -1 to 3, so some moves are off the board
+  bench("validMove/fullscan3x3", [&](){
+    int k = next++ & (POSITIONS - 1);
+    bool ok = fullScanValidMove(smallBoards[k], k % 5 - 1, k / 5 % 5 - 1);
+    keep(ok);
+  });
+  bench("validMove/packed3x3", [&](){
+    int k = next++ & (POSITIONS - 1);
+    bool ok = small[k].pos.validMove(k % 5 - 1, k / 5 % 5 - 1);
+    keep(ok);
+  });
+  bench("validMove/matrix3x3", [&](){
+    int k = next++ & (POSITIONS - 1);
+    bool ok = rules3.validMove(smallBoards[k], k % 5 - 1, k / 5 % 5 - 1);
+    keep(ok);
+  });
+
+  //formatting a board for output (without writing it)
+  boardRenderer renderer;
+  bench("render.compact/matrix3x3", [&](){
+    renderer.setFormat(RENDER_COMPACT);
+    int length = renderer.render(smallBoards[next++ & (POSITIONS - 1)], ' ');
+    keep(length);
+  });
+  bench("render.compact/packed15x15", [&](){
+    renderer.setFormat(RENDER_COMPACT);
+    int length = renderer.render(large[next++ & (POSITIONS - 1)].pos);
+    keep(length);
+  });
+  bench("render.fen/packed15x15", [&](){
+    renderer.setFormat(RENDER_FEN);
+    int length = renderer.render(large[next++ & (POSITIONS - 1)].pos);
+    keep(length);
+  });
+
+  //whole games; ops_per_sec is games per second
+  bench("game.random/packed3x3", [&](){
+    gameResult result = randomGame<3,3>(rng);
+    keep(result);
+  });
+  bench("game.random/packed15x15", [&](){
+    gameResult result = randomGame<15,5>(rng);
+    keep(result);
+  });
+  bench("game.random/matrix3x3", [&](){
+    gameResult result = randomMatrixGame(3, 3, rng);
+    keep(result);
+  });
+  bench("game.random/ultimate", [&](){
+    ultimateBoard game;
+    uint8_t moves[ultimateBoard::CELLS];
+    while(game.result() == ONGOING)
+      game.apply(moves[rng.below(game.legalMoves(moves))]);
+    keep(game);
+  });
+
+  //threat bookkeeping, 30 moves into a 15 x 15 game
+  threatState<15,5> threats;
+  uint8_t cells[225], tries[225];
+  while(threats.game().numMoves() < 30){
+    threats.apply(cells[rng.below(threats.candidates(cells))]);
+    if(threats.game().result() != ONGOING)//start again, it must go on
+      threats.clear();
+  }
+  int numTries = threats.candidates(tries);
+  bench("threats.applyUndo/packed15x15", [&](){
+    threats.apply(tries[next++ % numTries]);
+    threats.undo();
+    keep(threats);
+  });
+  bench("threats.evaluate/packed15x15", [&](){
+    int score = threats.evaluate();
+    keep(score);
+  });
+  bench("threats.candidates/packed15x15", [&](){
+    int n = threats.candidates(cells);
+    keep(n);
+  });
+
+  //a result cache hit, symmetry included (what main does before searching)
+  resultCache cache(4096);
+  for(int k = 0; k < POSITIONS; k++)
+    cache.store(large[k].pos, large[k].cell);
+  bench("cache.find/packed15x15", [&](){
+    int move = -1;
+    cache.find(large[next++ & (POSITIONS - 1)].pos, move);
+    keep(move);
+  });
+
+  solver<3,3> brain(14);
+  bitboard empty;
+  bench("solver.bestMove/empty3x3", [&](){
+    brain.clear();
+    int cell = brain.bestMove(empty);
+    keep(cell);
+  });
+
+  return 0;
+}
@@ -0,0 +1,181 @@
+//Builds an opening book (game/book.h) for main --book.
+//Usage: buildbook [size [run]] [--plies p] [--time ms] [--threads t]
+//                 [--out file]
+//
+//For each side the computer may play, the book gets the engine's move
+//in every position up to p moves in (default 4) that the computer can
+//reach by playing its own book moves against any replies.  Up to 4 x 4
+//the moves come from the solver and are exact; bigger boards use the
+//alpha-beta search for --time ms (default 1000) a position on
+//--threads cores (default all).  Symmetric positions are searched once.
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "../game/book.h"
+#include "../game/solver.h"
+#include "../game/absearch.h"
+
+using namespace std;
+
+//what has been searched or expanded so far, by canonical hash
+struct progress
+{
+  unordered_map<uint64_t, int> booked;  //book moves, canonical orientation
+  unordered_set<uint64_t> expanded;     //positions whose replies were tried
+  int searched;
+  int exact;
+
+  progress() : searched(0), exact(0) { }
+};
+
+/*Searches pos with the solver.
+Returns the move; score and exact describe it.
+*/
+template <int N, int K>
+int search(solver<N,K>&brain, const nkBoard<N,K>&pos, int&score, bool&exact)
+{
+  exact = true;
+  return brain.bestMove(pos, score);
+}
+
+/*Same as above with the alpha-beta search, exact only if it proved the
+value.
+*/
+template <int N, int K>
+int search(abSearch<N,K>&brain, const nkBoard<N,K>&pos, int&score, bool&exact)
+{
+  int move = brain.bestMove(pos, score);
+  exact = brain.proved();
+  return move;
+}
+
+/*Adds the book moves for side from pos on: side's move is searched and
+followed, every reply of the other player is tried, until plies moves
+are on the board.
+*/
+template <int N, int K, class brainType>
+void expand(brainType&brain, nkBoard<N,K>&pos, char side, int plies,
+            openingBook&book, progress&done)
+{
+  if(pos.numMoves() >= plies || resultOf(pos) != ONGOING)
+    return;
+  canonicalForm<N,K> form;
+  uint64_t key = canonicalKey(pos, form);
+  char p = pos.toMove();
+
+  if(p == side){
+    int move;
+    if(done.booked.count(key))//a symmetric position was searched
+      move = form.toOriginal(done.booked[key]);
+    else{
+      int score;
+      bool exact;
+      move = search(brain, pos, score, exact);
+      book.add(pos, move, score, exact);
+      done.booked[key] = form.toCanonical(move);
+      done.searched++;
+      done.exact += exact;
+      if(done.searched % 100 == 0)
+        cerr<<done.searched<<" positions searched"<<endl;
+    }
+    pos.apply(move, p);
+    expand(brain, pos, side, plies, book, done);
+    pos.undo(move);
+    return;
+  }
+
+  if(!done.expanded.insert(key).second)
+    return;
+  for(int cell = 0; cell < N * N; cell++){
+    if(!pos.isOpen(cell))
+      continue;
+    pos.apply(cell, p);
+    expand(brain, pos, side, plies, book, done);
+    pos.undo(cell);
+  }
+}
+
+/*Builds the book for both sides and writes it to path.
+*/
+template <int N, int K, class brainType>
+int build(brainType&brain, int plies, const string&path)
+{
+  openingBook book;
+  book.setBoard(N, K);
+  progress done;
+  auto begin = chrono::steady_clock::now();
+
+  nkBoard<N,K> empty;
+  expand(brain, empty, 'x', plies, book, done);
+  done.expanded.clear();
+  expand(brain, empty, 'o', plies, book, done);
+
+  if(!book.save(path.c_str())){
+    cerr<<"Can't write "<<path<<endl;
+    return 1;
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+  cout<<book.size()<<" positions ("<<done.exact<<" solved) written to "<<path
+      <<" in "<<seconds<<" s"<<endl;
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  int size = 3, run = 0, numbers = 0;
+  int plies = 4;
+  searchLimits limits;
+  limits.threads = 0;
+  string path;
+
+  for(int k = 1; k < argc; k++){
+    string arg = argv[k];
+    if(arg == "--plies" && k + 1 < argc)
+      plies = atoi(argv[++k]);
+    else if(arg == "--time" && k + 1 < argc)
+      limits.milliseconds = atoi(argv[++k]);
+    else if(arg == "--threads" && k + 1 < argc)
+      limits.threads = atoi(argv[++k]);
+    else if(arg == "--out" && k + 1 < argc)
+      path = argv[++k];
+    else{
+      if(numbers == 0)
+        size = atoi(argv[k]);
+      else if(numbers == 1)
+        run = atoi(argv[k]);
+      numbers++;
+    }
+  }
+  if(run == 0)
+    run = size;
+  if(path.empty())
+    path = to_string(size) + "x" + to_string(size) + "k" + to_string(run) + ".book";
+  if(plies < 1 || limits.milliseconds < 1 || limits.threads < 0){
+    cerr<<"Usage: "<<argv[0]<<" [size [run]] [--plies p] [--time ms] [--threads t]"
+        <<" [--out file] with p, ms >= 1"<<endl;
+    return 1;
+  }
+
+  if(size == 3 && run == 3){
+    solver<3,3> brain(14);
+    return build<3,3>(brain, plies, path);
+  }
+  if(size == 4 && run == 4){
+    solver<4,4> brain(22);
+    return build<4,4>(brain, plies, path);
+  }
+  if(size == 5 && run == 4){
+    abSearch<5,4> brain(limits);
+    return build<5,4>(brain, plies, path);
+  }
+  if(size == 15 && run == 5){
+    abSearch<15,5> brain(limits);
+    return build<15,5>(brain, plies, path);
+  }
+  cerr<<"Books are built for the packed sizes: 3 3, 4 4, 5 4 or 15 5"<<endl;
+  return 1;
+}
@@ -0,0 +1,117 @@
+//Builds the complete 3 x 3 outcome database (game/outcomedb.h).
+//Usage: builddb [file]        (default ttt3x3.db)
+
+#include <iostream>
+#include <cstdio>
+#include "../game/outcomedb.h"
+
+using namespace std;
+
+//every record, filled in as positions are reached
+dbRecord records[DB_RECORDS];
+
+//number of reachable positions found so far
+int positions = 0;
+
+/*Returns how a move that leads to child looks to the player who made it,
+given the child's record (which is from the opponent's point of view).
+*/
+dbRecord fromParent(const dbRecord&child)
+{
+  dbRecord r;
+  r.value = child.value == DB_WIN ? DB_LOSS : child.value == DB_LOSS ? DB_WIN : DB_DRAW;
+  r.distance = child.distance + 1;
+  r.bestMoves = 0;
+  return r;
+}
+
+/*Returns true if a is better for the mover than b:
+wins beat draws beat losses, quick wins beat slow ones,
+slow losses beat quick ones.
+*/
+bool better(const dbRecord&a, const dbRecord&b)
+{
+  int rank[4] = { 0, 3, 2, 1 };
+  if(a.value != b.value)
+    return rank[a.value] > rank[b.value];
+  if(a.value == DB_WIN)
+    return a.distance < b.distance;
+  return a.distance > b.distance;
+}
+
+/*Solves pos, which was reached by a legal game, and every position
+after it.  lastCell is the move that led here (-1 for the empty board).
+Uses the same rules as main.cpp: resultAfter checks the lines through
+the last move and a full board is a draw.
+*/
+const dbRecord&solve(bitboard&pos, int lastCell)
+{
+  dbRecord&rec = records[base3Index(pos)];
+  if(rec.value != DB_UNREACHABLE)
+    return rec;
+  positions++;
+
+  char mover = pos.toMove();
+  char last = mover == 'x' ? 'o' : 'x';
+  gameResult result = lastCell < 0 ? ONGOING : resultAfter(pos, lastCell, last);
+
+  if(result != ONGOING){//game over: the player to move lost, or a draw
+    rec.value = result == DRAW ? DB_DRAW : DB_LOSS;
+    rec.distance = 0;
+    rec.bestMoves = 0;
+    return rec;
+  }
+
+  dbRecord best;
+  best.value = DB_UNREACHABLE;
+  best.distance = 0;
+  best.bestMoves = 0;
+
+  for(int cell = 0; cell < bitboard::CELLS; cell++){
+    if(!pos.isOpen(cell))
+      continue;
+    pos.apply(cell, mover);
+    dbRecord r = fromParent(solve(pos, cell));
+    pos.undo(cell);
+
+    if(best.value == DB_UNREACHABLE || better(r, best)){
+      best = r;
+      best.bestMoves = (uint16_t) (1 << cell);
+    }
+    else if(r.value == best.value && r.distance == best.distance){
+      best.bestMoves |= (uint16_t) (1 << cell);
+    }
+  }
+
+  records[base3Index(pos)] = best;
+  return records[base3Index(pos)];
+}
+
+int main(int argc, char *argv[])
+{
+  const char *path = argc > 1 ? argv[1] : "ttt3x3.db";
+
+  bitboard empty;
+  solve(empty, -1);
+
+  dbHeader header;
+  memcpy(header.magic, DB_MAGIC, sizeof(DB_MAGIC));
+  header.version = DB_VERSION;
+  header.positions = positions;
+
+  FILE *out = fopen(path, "wb");
+  if(!out){
+    cerr<<"Can't write "<<path<<endl;
+    return 1;
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+            fwrite(records, sizeof(dbRecord), DB_RECORDS, out) == (size_t) DB_RECORDS;
+  ok = (fclose(out) == 0) && ok;
+  if(!ok){
+    cerr<<"Write to "<<path<<" failed"<<endl;
+    return 1;
+  }
+
+  cout<<positions<<" positions written to "<<path<<endl;
+  return 0;
+}
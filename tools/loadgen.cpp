@@ -0,0 +1,324 @@
+//Load generator for the game server (tools/server.cpp).  Keeps a number
+//of connections open on loopback; each one plays a random game, checks
+//every reply against its own copy of the board, hangs up and connects
+//again.  Reports sessions (whole games on their own connection) per
+//second and the move latency percentiles.
+//Usage: loadgen [size [run]] [--port p] [--connections c] [--games g]
+//               [--threads t]
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include "../game/winlines.h"
+#include "../game/rng.h"
+#include "../m/mlist.h"
+
+using namespace std;
+
+//latencies are counted in microsecond buckets up to this; slower moves
+//go into the last bucket
+const int MAX_MICROS = 1000000;
+
+//sessions still to be started, shared by all threads
+atomic<long long> toStart(0);
+
+//what one thread has measured, aligned so threads never share a line
+struct alignas(64) tally
+{
+  long long sessions;
+  long long moves;
+  long long mismatches;
+  long long failures;
+  vector<long long> latency;//moves taking k microseconds
+
+  tally() : sessions(0), moves(0), mismatches(0), failures(0), latency(MAX_MICROS + 1, 0) { }
+};
+
+//one connection playing one game
+template <int N, int K>
+struct client
+{
+  nkBoard<N,K> pos;//our copy of the server's board
+  char player;//who makes the next move
+  int fd;
+  int cell;//the move waiting for a reply
+  gameResult expect;//what that move should do to the game
+  int inLength;
+  char in[64];
+  chrono::steady_clock::time_point sent;
+};
+
+/*Returns a nonblocking socket that is connecting to port on loopback.
+*/
+int connectTo(int port)
+{
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if(fd < 0)
+    return -1;
+  int on = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if(connect(fd, (sockaddr *) &addr, sizeof(addr)) != 0 && errno != EINPROGRESS){
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/*Starts a new session in c if any are left to start.
+Returns false when there are none, or the connection failed.
+*/
+template <int N, int K>
+bool start(int epfd, int slot, client<N,K>&c, int port, tally&t)
+{
+  c.fd = -1;
+  if(toStart.fetch_sub(1) <= 0)
+    return false;
+  c.fd = connectTo(port);
+  if(c.fd < 0){
+    t.failures++;
+    return false;
+  }
+  c.pos = nkBoard<N,K>();
+  c.player = 'x';
+  c.inLength = 0;
+  c.cell = -1;
+
+  //the first move goes out once the connection is writable
+  epoll_event ev;
+  ev.events = EPOLLOUT;
+  ev.data.u32 = (uint32_t) slot;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, c.fd, &ev);
+  return true;
+}
+
+/*Picks a random open cell, works out what it should do to the game and
+sends it.  Returns false if the send failed.
+*/
+template <int N, int K>
+bool sendMove(client<N,K>&c, fastRng&rng)
+{
+  do{
+    c.cell = rng.below(N * N);
+  }while(!c.pos.isOpen(c.cell));
+  c.pos.apply(c.cell, c.player);
+  c.expect = resultAfter(c.pos, c.cell, c.player);
+  c.player = (c.player == 'x') ? 'o' : 'x';
+
+  char line[32];
+  int length = snprintf(line, sizeof(line), "move %d %d\n", c.cell / N, c.cell % N);
+  c.sent = chrono::steady_clock::now();
+  return send(c.fd, line, length, MSG_NOSIGNAL) == length;
+}
+
+/*Checks a reply against the move it answers.
+*/
+bool replyMatches(const char *line, gameResult expect)
+{
+  if(expect == ONGOING)
+    return strcmp(line, "ok") == 0;
+  if(expect == DRAW)
+    return strcmp(line, "draw") == 0;
+  return strcmp(line, expect == X_WINS ? "win x" : "win o") == 0;
+}
+
+/*One thread's event loop: keeps its connections playing until no sessions
+are left to start.
+*/
+template <int N, int K>
+void drive(int port, int connections, unsigned long long seed, tally&t)
+{
+  int epfd = epoll_create1(0);
+  mlist<client<N,K> > clients(connections);
+  fastRng rng(seed);
+  int active = 0;
+  for(int k = 0; k < connections; k++)
+    if(start(epfd, k, clients[k], port, t))
+      active++;
+
+  const int EVENTS = 256;
+  epoll_event events[EVENTS];
+  char buffer[256];
+  while(active > 0){
+    int ready = epoll_wait(epfd, events, EVENTS, 1000);
+    if(ready == 0){//the server has stopped answering
+      t.failures += active;
+      break;
+    }
+    for(int k = 0; k < ready; k++){
+      int slot = (int) events[k].data.u32;
+      client<N,K>&c = clients[slot];
+      bool done = false, failed = false;
+
+      if(events[k].events & (EPOLLERR | EPOLLHUP))
+        failed = true;
+      else if(events[k].events & EPOLLOUT){//connected: make the first move
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = (uint32_t) slot;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, c.fd, &ev);
+        failed = !sendMove(c, rng);
+      }
+      else{
+        ssize_t got = recv(c.fd, buffer, sizeof(buffer), 0);
+        if(got <= 0)
+          failed = got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+        for(ssize_t b = 0; b < got && !done && !failed; b++){
+          if(buffer[b] != '\n'){
+            if(c.inLength < (int) sizeof(c.in) - 1)
+              c.in[c.inLength++] = buffer[b];
+            continue;
+          }
+          c.in[c.inLength] = '\0';
+          c.inLength = 0;
+
+          long long micros = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - c.sent).count();
+          t.latency[micros < MAX_MICROS ? micros : MAX_MICROS]++;
+          t.moves++;
+          if(!replyMatches(c.in, c.expect)){
+            t.mismatches++;
+            failed = true;
+          }
+          else if(c.expect != ONGOING)
+            done = true;
+          else
+            failed = !sendMove(c, rng);
+        }
+      }
+
+      if(done || failed){
+        if(done)
+          t.sessions++;
+        else
+          t.failures++;
+        epoll_ctl(epfd, EPOLL_CTL_DEL, c.fd, 0);
+        close(c.fd);
+        if(!start(epfd, slot, c, port, t))
+          active--;
+      }
+    }
+  }
+  for(int k = 0; k < connections; k++)
+    if(clients[k].fd >= 0)
+      close(clients[k].fd);
+  close(epfd);
+}
+
+/*Returns the latency in microseconds that fraction of the moves beat.
+*/
+long long percentile(const vector<long long>&latency, long long moves, double fraction)
+{
+  long long wanted = (long long) (moves * fraction);
+  if(wanted >= moves)
+    wanted = moves - 1;
+  long long seen = 0;
+  for(size_t us = 0; us < latency.size(); us++){
+    seen += latency[us];
+    if(seen > wanted)
+      return (long long) us;
+  }
+  return (long long) latency.size() - 1;
+}
+
+template <int N, int K>
+int run(int port, int connections, long long games, int threads)
+{
+  toStart = games;
+  vector<tally> tallies(threads);
+  vector<thread> drivers;
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  for(int k = 0; k < threads; k++){
+    int share = connections / threads + (k < connections % threads ? 1 : 0);
+    drivers.push_back(thread(drive<N,K>, port, share, 1234567ULL + k, ref(tallies[k])));
+  }
+  for(int k = 0; k < threads; k++)
+    drivers[k].join();
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+  tally total;
+  for(int k = 0; k < threads; k++){
+    total.sessions += tallies[k].sessions;
+    total.moves += tallies[k].moves;
+    total.mismatches += tallies[k].mismatches;
+    total.failures += tallies[k].failures;
+    for(int us = 0; us <= MAX_MICROS; us++)
+      total.latency[us] += tallies[k].latency[us];
+  }
+  if(seconds <= 0)
+    seconds = 1e-9;
+
+  cout<<"sessions    "<<total.sessions<<endl;
+  cout<<"moves       "<<total.moves<<endl;
+  cout<<"mismatches  "<<total.mismatches<<endl;
+  cout<<"failures    "<<total.failures<<endl;
+  cout<<"seconds     "<<seconds<<endl;
+  cout<<"sessions/s  "<<total.sessions / seconds<<endl;
+  cout<<"moves/s     "<<total.moves / seconds<<endl;
+  cout<<"p50 move us "<<percentile(total.latency, total.moves, 0.50)<<endl;
+  cout<<"p99 move us "<<percentile(total.latency, total.moves, 0.99)<<endl;
+  cout<<"max move us "<<percentile(total.latency, total.moves, 1.0)
+      <<(total.latency[MAX_MICROS] > 0 ? " or more" : "")<<endl;
+  return (total.mismatches > 0 || total.failures > 0) ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+  int size = 3, run3 = 0, numbers = 0;
+  int port = 7777, connections = 1000, threads = 1;
+  long long games = 100000;
+
+  for(int k = 1; k < argc; k++){
+    string arg = argv[k];
+    if(arg == "--port" && k + 1 < argc)
+      port = atoi(argv[++k]);
+    else if(arg == "--connections" && k + 1 < argc)
+      connections = atoi(argv[++k]);
+    else if(arg == "--games" && k + 1 < argc)
+      games = atoll(argv[++k]);
+    else if(arg == "--threads" && k + 1 < argc)
+      threads = atoi(argv[++k]);
+    else{
+      if(numbers == 0)
+        size = atoi(argv[k]);
+      else if(numbers == 1)
+        run3 = atoi(argv[k]);
+      numbers++;
+    }
+  }
+  if(run3 == 0)
+    run3 = size;
+  if(threads < 1 || connections < threads || games < 1){
+    cerr<<"Usage: "<<argv[0]<<" [size [run]] [--port p] [--connections c] [--games g] [--threads t]"<<endl;
+    return 1;
+  }
+
+  if(size == 3 && run3 == 3)
+    return run<3,3>(port, connections, games, threads);
+  if(size == 4 && run3 == 4)
+    return run<4,4>(port, connections, games, threads);
+  if(size == 5 && run3 == 4)
+    return run<5,4>(port, connections, games, threads);
+  if(size == 15 && run3 == 5)
+    return run<15,5>(port, connections, games, threads);
+
+  cerr<<"The server supports the packed sizes: 3 3, 4 4, 5 4, 15 5"<<endl;
+  return 1;
+}
@@ -0,0 +1,441 @@
+//Counts every legal move sequence from a position down to a depth, and
+//how the games that end on the way end, to check the engines against
+//each other and time them.  Subtrees are split across all cores.
+//Usage: perft [size [run]] [--depth d] [--moves 4,0,8] [--threads t]
+//             [--engine state|packed|matrix] [--cache bits]
+//
+//  state   gameState apply/undo with line counters (game/gamestate.h)
+//  packed  nkBoard with isOpen and resultAfter, what validMove/checkWin
+//          use on the packed sizes
+//  matrix  matrix<char> with the matrix rules' validMove/resultAfter,
+//          what the game uses on every other size
+//
+//The full 3 x 3 tree from the empty board is checked against the known
+//totals (255168 games).  --cache keeps 2^bits subtree counts per thread,
+//keyed by Zobrist hash and depth (state engine only).
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "../game/gamestate.h"
+#include "../game/matrixrules.h"
+#include "../game/workpool.h"
+
+using namespace std;
+
+//what a subtree holds: positions reached below its root, those exactly
+//depth moves down, and the games that ended within depth
+struct counts
+{
+  long long nodes;
+  long long leaves;
+  long long xWins;
+  long long oWins;
+  long long draws;
+
+  counts() : nodes(0), leaves(0), xWins(0), oWins(0), draws(0) { }
+
+  void add(const counts&c)
+  {
+    nodes += c.nodes;
+    leaves += c.leaves;
+    xWins += c.xWins;
+    oWins += c.oWins;
+    draws += c.draws;
+  }
+
+  long long games() const
+  {
+    return xWins + oWins + draws;
+  }
+};
+
+//one worker's share, aligned so that workers never share a cache line
+struct alignas(64) tally
+{
+  counts c;
+};
+
+/*Subtree counts already worked out, keyed by position hash and depth;
+a newer entry replaces whatever was in its slot.
+*/
+class countCache
+{
+  public:
+
+    explicit countCache(int bits)
+      : myEntries(1 << bits), myMask((1ULL << bits) - 1), myHits(0)
+    {
+      for(int k = 0; k < myEntries.size(); k++)
+        myEntries[k].depth = -1;
+    }
+
+    bool find(uint64_t hash, int depth, counts&c)
+    {
+      const entry&e = myEntries[(int) (hash & myMask)];
+      if(e.depth != depth || e.hash != hash)
+        return false;
+      c = e.c;
+      myHits++;
+      return true;
+    }
+
+    void store(uint64_t hash, int depth, const counts&c)
+    {
+      entry&e = myEntries[(int) (hash & myMask)];
+      e.hash = hash;
+      e.depth = depth;
+      e.c = c;
+    }
+
+    long long hits() const
+    {
+      return myHits;
+    }
+
+  private:
+
+    struct entry
+    {
+      uint64_t hash;
+      int depth;
+      counts c;
+    };
+
+    mlist<entry> myEntries;
+    uint64_t myMask;
+    long long myHits;
+};
+
+/*The three ways of playing the game that perft can count with.  Each
+has cells(), isOpen(cell), apply(cell) returning the result, undo(cell)
+and hash().
+*/
+template <int N, int K>
+struct stateEngine
+{
+  gameState<N,K> game;
+
+  int cells() const { return N * N; }
+  bool isOpen(int cell) const { return game.isOpen(cell); }
+  gameResult apply(int cell) { game.apply(cell); return game.result(); }
+  void undo(int) { game.undo(); }
+  uint64_t hash() const { return game.hash(); }
+};
+
+template <int N, int K>
+struct packedEngine
+{
+  nkBoard<N,K> pos;
+  char player;
+
+  packedEngine() : player('x') { }
+
+  int cells() const { return N * N; }
+  bool isOpen(int cell) const { return pos.isOpen(cell); }
+  gameResult apply(int cell)
+  {
+    pos.apply(cell, player);
+    gameResult result = resultAfter(pos, cell, player);
+    player = (player == 'x') ? 'o' : 'x';
+    return result;
+  }
+  void undo(int cell)
+  {
+    pos.undo(cell);
+    player = (player == 'x') ? 'o' : 'x';
+  }
+  uint64_t hash() const { return 0; }
+};
+
+struct matrixEngine
+{
+  matrix<char> board;
+  matrixRules<char> rules;
+  char player;
+  int moves;
+
+  matrixEngine(int size, int run)
+    : board(size, size, ' '), rules(size, run, ' ', 'x'), player('x'), moves(0) { }
+
+  int cells() const { return rules.size() * rules.size(); }
+  bool isOpen(int cell) const
+  {
+    return rules.validMove(board, cell / rules.size(), cell % rules.size());
+  }
+  gameResult apply(int cell)
+  {
+    int r = cell / rules.size(), c = cell % rules.size();
+    board[r][c] = player;
+    moves++;
+    player = (player == 'x') ? 'o' : 'x';
+    return rules.resultAfter(board, r, c, moves);
+  }
+  void undo(int cell)
+  {
+    board[cell / rules.size()][cell % rules.size()] = ' ';
+    moves--;
+    player = (player == 'x') ? 'o' : 'x';
+  }
+  uint64_t hash() const { return 0; }
+};
+
+/*Counts a move that ended the game.
+*/
+void tallyResult(gameResult result, counts&c)
+{
+  if(result == X_WINS)
+    c.xWins++;
+  else if(result == O_WINS)
+    c.oWins++;
+  else
+    c.draws++;
+}
+
+/*Adds the counts for the tree depth moves below e's position to c.
+Subtrees two or more moves deep go through cache when there is one.
+*/
+template <class engineType>
+void perft(engineType&e, int depth, counts&c, countCache *cache)
+{
+  counts here;
+  if(cache && depth >= 2 && cache->find(e.hash(), depth, here)){
+    c.add(here);
+    return;
+  }
+
+  int cells = e.cells();
+  for(int cell = 0; cell < cells; cell++){
+    if(!e.isOpen(cell))
+      continue;
+    gameResult result = e.apply(cell);
+    here.nodes++;
+    if(depth == 1)
+      here.leaves++;
+    if(result != ONGOING)
+      tallyResult(result, here);
+    else if(depth > 1)
+      perft(e, depth - 1, here, cache);
+    e.undo(cell);
+  }
+
+  if(cache && depth >= 2)
+    cache->store(e.hash(), depth, here);
+  c.add(here);
+}
+
+/*Walks the first split moves itself, counting them into c, and hands
+each subtree below to the pool.  prefix holds the moves from the start
+position to e's position.
+*/
+template <class engineType>
+void split(engineType&e, int depth, int splitDepth, vector<int>&prefix, counts&c,
+           workPool&pool, const engineType&start, vector<tally>&tallies,
+           vector<countCache *>&caches)
+{
+  int cells = e.cells();
+  for(int cell = 0; cell < cells; cell++){
+    if(!e.isOpen(cell))
+      continue;
+    gameResult result = e.apply(cell);
+    c.nodes++;
+    if(depth == 1)
+      c.leaves++;
+    if(result != ONGOING)
+      tallyResult(result, c);
+    else if(depth > 1){
+      prefix.push_back(cell);
+      if(splitDepth > 1)
+        split(e, depth - 1, splitDepth - 1, prefix, c, pool, start, tallies, caches);
+      else{
+        vector<int> moves = prefix;
+        int below = depth - 1;
+        pool.submit([&start, &tallies, &caches, moves, below](int w){
+          engineType sub = start;
+          for(size_t k = 0; k < moves.size(); k++)
+            sub.apply(moves[k]);
+          perft(sub, below, tallies[w].c, caches[w]);
+        });
+      }
+      prefix.pop_back();
+    }
+    e.undo(cell);
+  }
+}
+
+/*Plays moves (a list like 4,0,8 of cells, row * size + col) on e.
+Returns false if one is off the board, taken, or comes after the end.
+*/
+template <class engineType>
+bool playMoves(engineType&e, const string&moves, int&played)
+{
+  played = 0;
+  gameResult result = ONGOING;
+  size_t at = 0;
+  while(at < moves.size()){
+    size_t comma = moves.find(',', at);
+    if(comma == string::npos)
+      comma = moves.size();
+    string token = moves.substr(at, comma - at);
+    at = comma + 1;
+    if(token.empty() || token.find_first_not_of("0123456789") != string::npos)
+      return false;
+    int cell = atoi(token.c_str());
+    if(result != ONGOING || cell >= e.cells() || !e.isOpen(cell))
+      return false;
+    result = e.apply(cell);
+    played++;
+  }
+  return result == ONGOING;
+}
+
+/*Counts the tree from start and prints the totals.
+Returns false if they do not match the reference ones.
+*/
+template <class engineType>
+bool run(engineType&start, int depth, int threads, int cacheBits, bool reference)
+{
+  workPool pool(threads);
+  vector<tally> tallies(pool.size());
+  vector<countCache *> caches(pool.size(), (countCache *) 0);
+  if(cacheBits > 0)
+    for(int w = 0; w < pool.size(); w++)
+      caches[w] = new countCache(cacheBits);
+
+  //split deep enough to give every worker several subtrees
+  int open = 0;
+  for(int cell = 0; cell < start.cells(); cell++)
+    open += start.isOpen(cell);
+  int splitDepth = 0;
+  long long subtrees = 1;
+  while(splitDepth < depth - 1 && splitDepth < open && subtrees < 16LL * pool.size())
+    subtrees *= open - splitDepth++;
+
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  counts total;
+  if(splitDepth == 0){
+    tally one;
+    perft(start, depth, one.c, caches[0]);
+    total.add(one.c);
+  }
+  else{
+    engineType e = start;
+    vector<int> prefix;
+    split(e, depth, splitDepth, prefix, total, pool, start, tallies, caches);
+    pool.wait();
+    for(size_t w = 0; w < tallies.size(); w++)
+      total.add(tallies[w].c);
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+  long long hits = 0;
+  for(size_t w = 0; w < caches.size(); w++)
+    if(caches[w]){
+      hits += caches[w]->hits();
+      delete caches[w];
+    }
+
+  cout<<"depth     "<<depth<<endl;
+  cout<<"nodes     "<<total.nodes<<endl;
+  cout<<"leaves    "<<total.leaves<<endl;
+  cout<<"games     "<<total.games()<<endl;
+  cout<<"x wins    "<<total.xWins<<endl;
+  cout<<"o wins    "<<total.oWins<<endl;
+  cout<<"draws     "<<total.draws<<endl;
+  if(cacheBits > 0)
+    cout<<"hits      "<<hits<<endl;
+  cout<<"seconds   "<<seconds<<endl;
+  cout<<"nodes/s   "<<total.nodes / (seconds > 0 ? seconds : 1e-9)<<endl;
+
+  if(!reference)
+    return true;
+  //every game of 3 x 3 tic-tac-toe
+  bool ok = total.nodes == 549945 && total.games() == 255168 && total.xWins == 131184 &&
+            total.oWins == 77904 && total.draws == 46080;
+  cout<<"reference "<<(ok ? "ok" : "MISMATCH")<<endl;
+  return ok;
+}
+
+/*Sets up the start position for one of the engines and counts from it.
+*/
+template <class engineType>
+int start(engineType e, int depth, const string&moves, int threads, int cacheBits, bool full)
+{
+  int played;
+  if(!playMoves(e, moves, played)){
+    cerr<<"--moves must list open cells (row * size + col) of a game still going"<<endl;
+    return 1;
+  }
+  if(depth == 0)
+    depth = e.cells() - played;
+  if(depth < 1){
+    cerr<<"The depth must be at least 1"<<endl;
+    return 1;
+  }
+  bool reference = full && played == 0 && depth == e.cells();
+  return run(e, depth, threads, cacheBits, reference) ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+  int size = 3, run3 = 0, numbers = 0;
+  int depth = 0, threads = 0, cacheBits = 0;
+  string engine = "state", moves;
+
+  for(int k = 1; k < argc; k++){
+    string arg = argv[k];
+    if(arg == "--depth" && k + 1 < argc)
+      depth = atoi(argv[++k]);
+    else if(arg == "--threads" && k + 1 < argc)
+      threads = atoi(argv[++k]);
+    else if(arg == "--cache" && k + 1 < argc)
+      cacheBits = atoi(argv[++k]);
+    else if(arg == "--engine" && k + 1 < argc)
+      engine = argv[++k];
+    else if(arg == "--moves" && k + 1 < argc)
+      moves = argv[++k];
+    else{
+      if(numbers == 0)
+        size = atoi(argv[k]);
+      else if(numbers == 1)
+        run3 = atoi(argv[k]);
+      numbers++;
+    }
+  }
+  if(run3 == 0)
+    run3 = size;
+  if(size < 1 || size > 15 || run3 < 1 || run3 > size || depth < 0 || threads < 0 ||
+     cacheBits < 0 || cacheBits > 30 ||
+     (engine != "state" && engine != "packed" && engine != "matrix")){
+    cerr<<"Usage: "<<argv[0]<<" [size [run]] [--depth d] [--moves 4,0,8] [--threads t]"
+        <<" [--engine state|packed|matrix] [--cache bits]"<<endl;
+    return 1;
+  }
+  if(cacheBits > 0 && engine != "state"){
+    cerr<<"--cache needs the state engine, the others keep no hash"<<endl;
+    return 1;
+  }
+
+  bool full = size == 3 && run3 == 3;
+  if(engine == "matrix")
+    return start(matrixEngine(size, run3), depth, moves, threads, cacheBits, full);
+
+  if(size == 3 && run3 == 3)
+    return engine == "state" ? start(stateEngine<3,3>(), depth, moves, threads, cacheBits, full)
+                             : start(packedEngine<3,3>(), depth, moves, threads, cacheBits, full);
+  if(size == 4 && run3 == 4)
+    return engine == "state" ? start(stateEngine<4,4>(), depth, moves, threads, cacheBits, full)
+                             : start(packedEngine<4,4>(), depth, moves, threads, cacheBits, full);
+  if(size == 5 && run3 == 4)
+    return engine == "state" ? start(stateEngine<5,4>(), depth, moves, threads, cacheBits, full)
+                             : start(packedEngine<5,4>(), depth, moves, threads, cacheBits, full);
+  if(size == 15 && run3 == 5)
+    return engine == "state" ? start(stateEngine<15,5>(), depth, moves, threads, cacheBits, full)
+                             : start(packedEngine<15,5>(), depth, moves, threads, cacheBits, full);
+
+  cerr<<"The state and packed engines need one of the packed sizes: 3 3, 4 4, 5 4, 15 5"
+      <<"; use --engine matrix"<<endl;
+  return 1;
+}
@@ -0,0 +1,190 @@
+//Replays and re-validates every game in a record file (game/record.h)
+//on all cores, straight out of the memory-mapped file.
+//Usage: replay file [--threads t]
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "../game/record.h"
+#include "../game/matrixrules.h"
+#include "../game/workpool.h"
+
+using namespace std;
+
+//games handed to a worker at a time
+const long long CHUNK = 65536;
+
+//what one worker has seen, aligned to a cache line of its own so that
+//workers never write to the same one
+struct alignas(64) tally
+{
+  long long games;
+  long long invalid;
+  long long xWins;
+  long long oWins;
+  long long draws;
+  long long moves;
+
+  tally() : games(0), invalid(0), xWins(0), oWins(0), draws(0), moves(0) { }
+};
+
+/*Replays game on a packed board.
+Returns true if every move was on an open cell, the game did not end
+before its last move and it ended with the recorded result.
+*/
+template <int N, int K>
+bool replayPacked(const recView&game)
+{
+  nkBoard<N,K> pos;
+  char player = 'x';
+  gameResult result = ONGOING;
+  for(int k = 0; k < game.numMoves; k++){
+    int cell = game.moves[k];
+    if(result != ONGOING || cell >= N * N || !pos.isOpen(cell))//validMove
+      return false;
+    pos.apply(cell, player);
+    result = resultAfter(pos, cell, player);//checkWin
+    player = (player == 'x') ? 'o' : 'x';
+  }
+  return result == game.result;
+}
+
+/*Same as above on a matrix with the matrix rules, for board sizes with
+no packed version.
+*/
+bool replayMatrix(const recView&game)
+{
+  matrix<char> board(game.size, game.size, ' ');
+  matrixRules<char> rules(game.size, game.run, ' ', 'x');
+  char player = 'x';
+  gameResult result = ONGOING;
+  for(int k = 0; k < game.numMoves; k++){
+    int r = game.moves[k] / game.size;
+    int c = game.moves[k] % game.size;
+    if(result != ONGOING || !rules.validMove(board, r, c))
+      return false;
+    board[r][c] = player;
+    result = rules.resultAfter(board, r, c, k + 1);
+    player = (player == 'x') ? 'o' : 'x';
+  }
+  return result == game.result;
+}
+
+/*Checks one game of any size.  A record is only valid for a finished
+game, so a stored result other than X_WINS, O_WINS or DRAW is rejected.
+*/
+bool replay(const recView&game)
+{
+  if(game.size < 1 || game.size > REC_MAX_SIZE || game.run < 1 ||
+     game.run > game.size || game.numMoves > game.size * game.size)
+    return false;
+  if(game.result != X_WINS && game.result != O_WINS && game.result != DRAW)
+    return false;
+  if(game.size == 3 && game.run == 3)
+    return replayPacked<3,3>(game);
+  if(game.size == 4 && game.run == 4)
+    return replayPacked<4,4>(game);
+  if(game.size == 5 && game.run == 4)
+    return replayPacked<5,4>(game);
+  if(game.size == 15 && game.run == 5)
+    return replayPacked<15,5>(game);
+  return replayMatrix(game);
+}
+
+/*Replays the games from offset first up to offset last into t.
+*/
+void replayRange(const recordReader&in, size_t first, size_t last, tally&t)
+{
+  recView game;
+  size_t at = first;
+  while(at < last && in.next(at, game)){
+    t.games++;
+    t.moves += game.numMoves;
+    if(!replay(game))
+      t.invalid++;
+    else if(game.result == X_WINS)
+      t.xWins++;
+    else if(game.result == O_WINS)
+      t.oWins++;
+    else if(game.result == DRAW)
+      t.draws++;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  string path;
+  int threads = 0;
+  for(int k = 1; k < argc; k++){
+    string arg = argv[k];
+    if(arg == "--threads" && k + 1 < argc)
+      threads = atoi(argv[++k]);
+    else
+      path = arg;
+  }
+  if(path.empty()){
+    cerr<<"Usage: "<<argv[0]<<" file [--threads t]"<<endl;
+    return 1;
+  }
+
+  recordReader in;
+  if(!in.open(path.c_str())){
+    cerr<<"Can't read the game record "<<path<<endl;
+    return 1;
+  }
+
+  workPool pool(threads);
+  vector<tally> tallies(pool.size());
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  //games have different lengths, so chunk boundaries are found by
+  //hopping over the game headers; workers replay each chunk meanwhile
+  recView game;
+  size_t at = in.begin();
+  size_t chunkStart = at;
+  long long inChunk = 0;
+  while(in.next(at, game)){
+    if(++inChunk == CHUNK){
+      size_t first = chunkStart, last = at;
+      pool.submit([&, first, last](int w){ replayRange(in, first, last, tallies[w]); });
+      chunkStart = at;
+      inChunk = 0;
+    }
+  }
+  if(inChunk > 0){
+    size_t first = chunkStart, last = at;
+    pool.submit([&, first, last](int w){ replayRange(in, first, last, tallies[w]); });
+  }
+  pool.wait();
+
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  tally total;
+  for(size_t w = 0; w < tallies.size(); w++){
+    total.games += tallies[w].games;
+    total.invalid += tallies[w].invalid;
+    total.xWins += tallies[w].xWins;
+    total.oWins += tallies[w].oWins;
+    total.draws += tallies[w].draws;
+    total.moves += tallies[w].moves;
+  }
+
+  double n = total.games > 0 ? (double) total.games : 1.0;
+  cout<<"games    "<<total.games<<endl;
+  cout<<"invalid  "<<total.invalid<<endl;
+  cout<<"x wins   "<<total.xWins<<" ("<<100.0 * total.xWins / n<<"%)"<<endl;
+  cout<<"o wins   "<<total.oWins<<" ("<<100.0 * total.oWins / n<<"%)"<<endl;
+  cout<<"draws    "<<total.draws<<" ("<<100.0 * total.draws / n<<"%)"<<endl;
+  cout<<"moves    "<<total.moves / n<<" per game"<<endl;
+  cout<<"seconds  "<<seconds<<endl;
+  cout<<"games/s  "<<total.games / (seconds > 0 ? seconds : 1e-9)<<endl;
+  cout<<"MB/s     "<<(in.end() - in.begin()) / 1e6 / (seconds > 0 ? seconds : 1e-9)<<endl;
+
+  if(at < in.end()){
+    cerr<<"The record is cut off at byte "<<at<<endl;
+    return 1;
+  }
+  return total.invalid > 0 ? 1 : 0;
+}
@@ -0,0 +1,189 @@
+//Headless self-play: plays many games between two strategies on all
+//cores and reports win/draw/loss rates and games per second.
+//Usage: selfplay [size [run]] [--x random|heuristic|solver|mcts|ab]
+//                [--o random|heuristic|solver|mcts|ab] [--games n] [--threads t]
+//                [--seed s] [--record file]
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include "../game/strategy.h"
+#include "../game/workpool.h"
+#include "../game/record.h"
+
+using namespace std;
+
+//games handed to a worker at a time
+const long long BATCH = 1024;
+
+//where finished games go with --record (see tools/replay.cpp)
+recordWriter recorder;
+
+//one worker's generator and the results of the games it has played,
+//aligned to a cache line of its own so that workers never write to the
+//same one
+struct alignas(64) tally
+{
+  fastRng rng;
+  long long games;
+  long long xWins;
+  long long oWins;
+  long long draws;
+  long long moves;
+
+  tally() : rng(1), games(0), xWins(0), oWins(0), draws(0), moves(0) { }
+};
+
+/*Plays one game between xs and os with t's generator and records it
+in t.  When recording, the game is also encoded onto the end of out.
+*/
+template <int N, int K>
+void playGame(strategy<N,K>&xs, strategy<N,K>&os, tally&t,
+              vector<uint8_t> *out)
+{
+  nkBoard<N,K> pos;
+  char player = 'x';
+  gameResult result = ONGOING;
+  uint8_t moves[N * N];
+  int numMoves = 0;
+
+  while(result == ONGOING){
+    strategy<N,K>&mover = (player == 'x') ? xs : os;
+    int cell = mover.chooseMove(pos, player, t.rng);
+    pos.apply(cell, player);
+    result = resultAfter(pos, cell, player);
+    player = (player == 'x') ? 'o' : 'x';
+    moves[numMoves++] = (uint8_t) cell;
+    t.moves++;
+  }
+
+  if(out){
+    size_t end = out->size();
+    out->resize(end + 4 + numMoves);
+    recordWriter::encode(&(*out)[end], N, K, moves, numMoves, result);
+  }
+
+  t.games++;
+  if(result == X_WINS)
+    t.xWins++;
+  else if(result == O_WINS)
+    t.oWins++;
+  else
+    t.draws++;
+}
+
+/*Plays games games on every core and prints the merged statistics.
+Each batch reseeds its worker's generator from the batch number, so the
+totals are the same for any thread count.
+*/
+template <int N, int K>
+int simulate(const string&xName, const string&oName, long long games,
+             int threads, uint64_t seed)
+{
+  workPool pool(threads);
+  int workers = pool.size();
+
+  //per-worker strategies, generators and results
+  vector<strategy<N,K> *> xs(workers), os(workers);
+  vector<tally> tallies(workers);
+  for(int w = 0; w < workers; w++){
+    xs[w] = makeStrategy<N,K>(xName);
+    os[w] = makeStrategy<N,K>(oName);
+    if(!xs[w] || !os[w]){
+      cerr<<"Unknown strategy; use random, heuristic, solver (up to 4 x 4), mcts or ab"<<endl;
+      return 1;
+    }
+  }
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  for(long long first = 0; first < games; first += BATCH){
+    long long count = games - first < BATCH ? games - first : BATCH;
+    pool.submit([&, first, count](int w){
+      tallies[w].rng.reseed(seed ^ (uint64_t) (first / BATCH + 1) * 0x9E3779B97F4A7C15ULL);
+      vector<uint8_t> out;
+      vector<uint8_t> *record = recorder.isOpen() ? &out : 0;
+      for(long long g = 0; g < count; g++)
+        playGame(*xs[w], *os[w], tallies[w], record);
+      if(record)
+        recorder.append(&out[0], out.size());//one write per batch
+    });
+  }
+  pool.wait();
+
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  //merge only at the end
+  tally total;
+  for(int w = 0; w < workers; w++){
+    total.games += tallies[w].games;
+    total.xWins += tallies[w].xWins;
+    total.oWins += tallies[w].oWins;
+    total.draws += tallies[w].draws;
+    total.moves += tallies[w].moves;
+    delete xs[w];
+    delete os[w];
+  }
+
+  double n = total.games > 0 ? (double) total.games : 1.0;
+  cout<<"board "<<N<<"x"<<N<<" k="<<K<<"  x="<<xName<<"  o="<<oName
+      <<"  threads="<<workers<<endl;
+  cout<<"games    "<<total.games<<endl;
+  cout<<"x wins   "<<total.xWins<<" ("<<100.0 * total.xWins / n<<"%)"<<endl;
+  cout<<"o wins   "<<total.oWins<<" ("<<100.0 * total.oWins / n<<"%)"<<endl;
+  cout<<"draws    "<<total.draws<<" ("<<100.0 * total.draws / n<<"%)"<<endl;
+  cout<<"moves    "<<total.moves / n<<" per game"<<endl;
+  cout<<"seconds  "<<seconds<<endl;
+  cout<<"games/s  "<<total.games / (seconds > 0 ? seconds : 1e-9)<<endl;
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  int size = 3, run = 0, numbers = 0, threads = 0;
+  long long games = 1000000;
+  uint64_t seed = 1;
+  string xName = "random", oName = "random";
+
+  for(int k = 1; k < argc; k++){
+    string arg = argv[k];
+    if(arg == "--x" && k + 1 < argc)
+      xName = argv[++k];
+    else if(arg == "--o" && k + 1 < argc)
+      oName = argv[++k];
+    else if(arg == "--games" && k + 1 < argc)
+      games = atoll(argv[++k]);
+    else if(arg == "--threads" && k + 1 < argc)
+      threads = atoi(argv[++k]);
+    else if(arg == "--seed" && k + 1 < argc)
+      seed = strtoull(argv[++k], 0, 10);
+    else if(arg == "--record" && k + 1 < argc){
+      if(!recorder.open(argv[++k])){
+        cerr<<"Can't append to the game record "<<argv[k]<<endl;
+        return 1;
+      }
+    }
+    else{
+      if(numbers == 0)
+        size = atoi(argv[k]);
+      else if(numbers == 1)
+        run = atoi(argv[k]);
+      numbers++;
+    }
+  }
+  if(run == 0)
+    run = size;
+
+  if(size == 3 && run == 3)
+    return simulate<3,3>(xName, oName, games, threads, seed);
+  if(size == 4 && run == 4)
+    return simulate<4,4>(xName, oName, games, threads, seed);
+  if(size == 5 && run == 4)
+    return simulate<5,4>(xName, oName, games, threads, seed);
+  if(size == 15 && run == 5)
+    return simulate<15,5>(xName, oName, games, threads, seed);
+
+  cerr<<"Self-play supports the packed sizes: 3 3, 4 4, 5 4, 15 5"<<endl;
+  return 1;
+}
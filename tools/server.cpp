@@ -0,0 +1,420 @@
+//Tic-tac-toe game server: thousands of games over TCP from epoll event
+//loops.  Each connection is one game at a time on a packed board; both
+//players send their moves over the same connection, x first.
+//Usage: server [size [run]] [--port p] [--threads t] [--sessions n]
+//              [--seconds s]
+//
+//Protocol, one line each way per move:
+//  client: move <row> <col>     server: ok | win x | win o | draw | illegal
+//  client: quit                 server closes the connection
+//After win or draw the board is cleared for a new game.  Anything else
+//gets "error".  Try it with: nc localhost 7777
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include "../game/winlines.h"
+#include "../m/mlist.h"
+
+using namespace std;
+
+//epoll data value that marks the listening socket
+const uint32_t LISTENER = 0xFFFFFFFF;
+
+//longest request line and most unsent reply bytes a session may hold
+const int LINE = 64;
+const int PENDING = 256;
+
+//set by SIGINT/SIGTERM, or when --seconds runs out
+atomic<bool> stopping(false);
+
+void onSignal(int)
+{
+  stopping = true;
+}
+
+//what one event loop has done, aligned so loops never share a line
+struct alignas(64) tally
+{
+  long long connections;
+  long long games;
+  long long moves;
+  long long illegal;
+  long long dropped;
+
+  tally() : connections(0), games(0), moves(0), illegal(0), dropped(0) { }
+};
+
+//one connection's game; sessions live in a pool and are reused
+template <int N, int K>
+struct session
+{
+  nkBoard<N,K> pos;//the game being played
+  char player;//whose move it is
+  int fd;//-1 while the slot is free
+  int inLength;//bytes of an unfinished request line
+  int outLength;//reply bytes the socket has not taken yet
+  char in[LINE];
+  char out[PENDING];
+};
+
+/*Fixed pool of sessions with a free list, so accepting a connection
+never allocates.
+*/
+template <int N, int K>
+class sessionPool
+{
+  public:
+
+    explicit sessionPool(int capacity)
+      : mySessions(capacity), myFree(capacity), myNumFree(capacity)
+    {
+      for(int k = 0; k < capacity; k++){
+        mySessions[k].fd = -1;
+        myFree[k] = capacity - 1 - k;
+      }
+    }
+
+    //returns a cleared session's slot, or -1 when the pool is full
+    int take(int fd)
+    {
+      if(myNumFree == 0)
+        return -1;
+      int slot = myFree[--myNumFree];
+      session<N,K>&s = mySessions[slot];
+      s.pos = nkBoard<N,K>();
+      s.player = 'x';
+      s.fd = fd;
+      s.inLength = 0;
+      s.outLength = 0;
+      return slot;
+    }
+
+    void give(int slot)
+    {
+      mySessions[slot].fd = -1;
+      myFree[myNumFree++] = slot;
+    }
+
+    session<N,K>&operator [](int slot)
+    {
+      return mySessions[slot];
+    }
+
+  private:
+
+    mlist<session<N,K> > mySessions;
+    mlist<int> myFree;
+    int myNumFree;
+};
+
+/*Returns a nonblocking listening socket on port, shared between the
+event loops with SO_REUSEPORT so the kernel spreads connections.
+*/
+int listenOn(int port)
+{
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if(fd < 0)
+    return -1;
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if(bind(fd, (sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, 4096) != 0){
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/*Sends reply, keeping whatever the socket does not take for EPOLLOUT.
+Returns false if the session must be dropped.
+*/
+template <int N, int K>
+bool reply(int epfd, int slot, session<N,K>&s, const char *text)
+{
+  int length = (int) strlen(text);
+  if(s.outLength == 0){
+    ssize_t sent = send(s.fd, text, length, MSG_NOSIGNAL);
+    if(sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+      return false;
+    if(sent == length)
+      return true;
+    if(sent > 0){
+      text += sent;
+      length -= (int) sent;
+    }
+  }
+  if(s.outLength + length > PENDING)//client is not reading its replies
+    return false;
+  memcpy(s.out + s.outLength, text, length);
+  s.outLength += length;
+
+  epoll_event ev;
+  ev.events = EPOLLIN | EPOLLOUT;
+  ev.data.u32 = (uint32_t) slot;
+  epoll_ctl(epfd, EPOLL_CTL_MOD, s.fd, &ev);
+  return true;
+}
+
+/*Carries out one request line.  The move is checked the same way as
+validMove (on the board and open) and the game the same way as checkWin
+(only the lines through the move).
+Returns false if the session should be closed.
+*/
+template <int N, int K>
+bool handle(int epfd, int slot, session<N,K>&s, const char *line, tally&t)
+{
+  int row, col, used = -1;
+  if(strcmp(line, "quit") == 0)
+    return false;
+  //the whole line must be the command, so "move 1 1 junk" is an error
+  if(sscanf(line, "move %d %d %n", &row, &col, &used) != 2 ||
+     used < 0 || line[used] != '\0')
+    return reply(epfd, slot, s, "error\n");
+
+  if(row < 0 || row >= N || col < 0 || col >= N ||
+     !s.pos.isOpen(nkBoard<N,K>::cellOf(row, col))){
+    t.illegal++;
+    return reply(epfd, slot, s, "illegal\n");
+  }
+
+  int cell = nkBoard<N,K>::cellOf(row, col);
+  s.pos.apply(cell, s.player);
+  gameResult result = resultAfter(s.pos, cell, s.player);
+  t.moves++;
+  s.player = (s.player == 'x') ? 'o' : 'x';
+  if(result == ONGOING)
+    return reply(epfd, slot, s, "ok\n");
+
+  t.games++;
+  s.pos = nkBoard<N,K>();
+  s.player = 'x';
+  if(result == DRAW)
+    return reply(epfd, slot, s, "draw\n");
+  return reply(epfd, slot, s, result == X_WINS ? "win x\n" : "win o\n");
+}
+
+/*Reads what the client sent and handles every complete line.
+Returns false if the session should be closed.
+*/
+template <int N, int K>
+bool readFrom(int epfd, int slot, session<N,K>&s, tally&t)
+{
+  char buffer[4096];
+  for(;;){
+    ssize_t got = recv(s.fd, buffer, sizeof(buffer), 0);
+    if(got == 0)
+      return false;
+    if(got < 0)
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+
+    for(ssize_t k = 0; k < got; k++){
+      char c = buffer[k];
+      if(c == '\r')
+        continue;
+      if(c != '\n'){
+        if(s.inLength == LINE - 1)//line too long
+          return false;
+        s.in[s.inLength++] = c;
+        continue;
+      }
+      s.in[s.inLength] = '\0';
+      s.inLength = 0;
+      if(!handle(epfd, slot, s, s.in, t))
+        return false;
+    }
+  }
+}
+
+/*Sends replies that were held back; stops watching for EPOLLOUT once
+they are all gone.  Returns false if the session should be closed.
+*/
+template <int N, int K>
+bool flushTo(int epfd, int slot, session<N,K>&s)
+{
+  ssize_t sent = send(s.fd, s.out, s.outLength, MSG_NOSIGNAL);
+  if(sent < 0)
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+  memmove(s.out, s.out + sent, s.outLength - sent);
+  s.outLength -= (int) sent;
+  if(s.outLength == 0){
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint32_t) slot;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, s.fd, &ev);
+  }
+  return true;
+}
+
+/*One event loop: accepts connections on its own listening socket and
+serves them until stopping is set.
+*/
+template <int N, int K>
+void serve(int port, int capacity, tally&t)
+{
+  int listener = listenOn(port);
+  int epfd = epoll_create1(0);
+  if(listener < 0 || epfd < 0){
+    cerr<<"Can't listen on port "<<port<<endl;
+    stopping = true;
+    return;
+  }
+  sessionPool<N,K> pool(capacity);
+
+  epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.u32 = LISTENER;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, listener, &ev);
+
+  const int EVENTS = 256;
+  epoll_event events[EVENTS];
+  while(!stopping){
+    int ready = epoll_wait(epfd, events, EVENTS, 100);
+    for(int k = 0; k < ready; k++){
+      uint32_t slot = events[k].data.u32;
+
+      if(slot == LISTENER){
+        for(;;){
+          int fd = accept4(listener, 0, 0, SOCK_NONBLOCK);
+          if(fd < 0)
+            break;
+          int s = pool.take(fd);
+          if(s < 0){//pool full: turn the connection away
+            close(fd);
+            t.dropped++;
+            continue;
+          }
+          int on = 1;
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+          ev.events = EPOLLIN;
+          ev.data.u32 = (uint32_t) s;
+          epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+          t.connections++;
+        }
+        continue;
+      }
+
+      session<N,K>&s = pool[slot];
+      bool keep = true;
+      if(events[k].events & (EPOLLERR | EPOLLHUP))
+        keep = false;
+      if(keep && (events[k].events & EPOLLOUT))
+        keep = flushTo(epfd, slot, s);
+      if(keep && (events[k].events & EPOLLIN))
+        keep = readFrom(epfd, slot, s, t);
+      if(!keep){
+        epoll_ctl(epfd, EPOLL_CTL_DEL, s.fd, 0);
+        close(s.fd);
+        pool.give(slot);
+      }
+    }
+  }
+
+  close(epfd);
+  close(listener);
+}
+
+/*Runs threads event loops until a signal or the time limit, then
+prints what they did.
+*/
+template <int N, int K>
+int run(int port, int threads, int capacity, int seconds)
+{
+  vector<tally> tallies(threads);
+  vector<thread> loops;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for(int k = 0; k < threads; k++)
+    loops.push_back(thread(serve<N,K>, port, capacity, ref(tallies[k])));
+
+  cout<<"serving "<<N<<"x"<<N<<" k="<<K<<" on port "<<port
+      <<" with "<<threads<<" event loop(s)"<<endl;
+  while(!stopping){
+    this_thread::sleep_for(chrono::milliseconds(100));
+    if(seconds > 0 && chrono::steady_clock::now() - start >= chrono::seconds(seconds))
+      stopping = true;
+  }
+  for(int k = 0; k < threads; k++)
+    loops[k].join();
+
+  tally total;
+  for(int k = 0; k < threads; k++){
+    total.connections += tallies[k].connections;
+    total.games += tallies[k].games;
+    total.moves += tallies[k].moves;
+    total.illegal += tallies[k].illegal;
+    total.dropped += tallies[k].dropped;
+  }
+  cout<<"connections "<<total.connections<<endl;
+  cout<<"games       "<<total.games<<endl;
+  cout<<"moves       "<<total.moves<<endl;
+  cout<<"illegal     "<<total.illegal<<endl;
+  cout<<"turned away "<<total.dropped<<endl;
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  int size = 3, run3 = 0, numbers = 0;
+  int port = 7777, threads = 1, capacity = 10000, seconds = 0;
+
+  for(int k = 1; k < argc; k++){
+    string arg = argv[k];
+    if(arg == "--port" && k + 1 < argc)
+      port = atoi(argv[++k]);
+    else if(arg == "--threads" && k + 1 < argc)
+      threads = atoi(argv[++k]);
+    else if(arg == "--sessions" && k + 1 < argc)
+      capacity = atoi(argv[++k]);
+    else if(arg == "--seconds" && k + 1 < argc)
+      seconds = atoi(argv[++k]);
+    else{
+      if(numbers == 0)
+        size = atoi(argv[k]);
+      else if(numbers == 1)
+        run3 = atoi(argv[k]);
+      numbers++;
+    }
+  }
+  if(run3 == 0)
+    run3 = size;
+  if(threads < 1 || capacity < 1){
+    cerr<<"Usage: "<<argv[0]<<" [size [run]] [--port p] [--threads t] [--sessions n] [--seconds s]"<<endl;
+    return 1;
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  if(size == 3 && run3 == 3)
+    return run<3,3>(port, threads, capacity, seconds);
+  if(size == 4 && run3 == 4)
+    return run<4,4>(port, threads, capacity, seconds);
+  if(size == 5 && run3 == 4)
+    return run<5,4>(port, threads, capacity, seconds);
+  if(size == 15 && run3 == 5)
+    return run<15,5>(port, threads, capacity, seconds);
+
+  cerr<<"The server supports the packed sizes: 3 3, 4 4, 5 4, 15 5"<<endl;
+  return 1;
+}